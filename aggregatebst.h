@@ -0,0 +1,618 @@
+
+#ifndef AGGREGATEBST_H
+#define AGGREGATEBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+#include "avlbst.h"
+
+/*
+ * Aggregate policies for AggregateTree. A policy supplies an identity
+ * element and an associative combine over Value; combine need not be
+ * commutative, since summaries are always combined in key order.
+ */
+
+/**
+* Sum of the values.
+*/
+template <typename Value>
+struct SumAggregate
+{
+    static Value identity() { return Value(); }
+    static Value combine(const Value& a, const Value& b) { return a + b; }
+};
+
+/**
+* Smallest value; the identity is the largest representable value.
+*/
+template <typename Value>
+struct MinAggregate
+{
+    static Value identity() { return std::numeric_limits<Value>::max(); }
+    static Value combine(const Value& a, const Value& b) { return std::min(a, b); }
+};
+
+/**
+* Largest value; the identity is the lowest representable value.
+*/
+template <typename Value>
+struct MaxAggregate
+{
+    static Value identity() { return std::numeric_limits<Value>::lowest(); }
+    static Value combine(const Value& a, const Value& b) { return std::max(a, b); }
+};
+
+/**
+* An AVLNode that also holds the aggregate of the live values in its
+* subtree, itself included.
+*/
+template <typename Key, typename Value>
+class AggregateNode : public AVLNode<Key, Value>
+{
+public:
+    // Constructor/destructor.
+    AggregateNode(const Key& key, const Value& value, AggregateNode<Key, Value>* parent);
+    virtual ~AggregateNode();
+
+    // Getter/setter for the subtree aggregate.
+    const Value& getSummary() const;
+    void setSummary(const Value& summary);
+
+    // Getters for parent, left, and right, redefined to return AggregateNodes.
+    virtual AggregateNode<Key, Value>* getParent() const override;
+    virtual AggregateNode<Key, Value>* getLeft() const override;
+    virtual AggregateNode<Key, Value>* getRight() const override;
+
+protected:
+    Value summary_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the AggregateNode class.
+  -------------------------------------------------
+*/
+
+/**
+* A new node is a leaf, so its summary is just its own value.
+*/
+template<class Key, class Value>
+AggregateNode<Key, Value>::AggregateNode(const Key& key, const Value& value, AggregateNode<Key, Value> *parent) :
+    AVLNode<Key, Value>(key, value, parent), summary_(value)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value>
+AggregateNode<Key, Value>::~AggregateNode()
+{
+
+}
+
+template<class Key, class Value>
+const Value& AggregateNode<Key, Value>::getSummary() const
+{
+    return summary_;
+}
+
+template<class Key, class Value>
+void AggregateNode<Key, Value>::setSummary(const Value& summary)
+{
+    summary_ = summary;
+}
+
+template<class Key, class Value>
+AggregateNode<Key, Value> *AggregateNode<Key, Value>::getParent() const
+{
+    return static_cast<AggregateNode<Key, Value>*>(this->parent_);
+}
+
+template<class Key, class Value>
+AggregateNode<Key, Value> *AggregateNode<Key, Value>::getLeft() const
+{
+    return static_cast<AggregateNode<Key, Value>*>(this->left_);
+}
+
+template<class Key, class Value>
+AggregateNode<Key, Value> *AggregateNode<Key, Value>::getRight() const
+{
+    return static_cast<AggregateNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the AggregateNode class.
+  -----------------------------------------------
+*/
+
+
+/**
+* An AVL tree that keeps, in every node, the Aggregate of the values in
+* its subtree, so that aggregate(lo, hi) folds the values of all keys
+* in [lo, hi) in O(log n) instead of walking the range.
+*
+* Summaries are kept up to date by insert (including overwrites), update,
+* remove, apply_batch, merge and the rebalancing rotations, which are the
+* only ways to change a value: iterators, operator[] and the walks
+* (for_each, visit, the parallel_ ones) only hand out const items. As
+* with RecordingTree, this holds for calls through the AggregateTree
+* itself, not through a reference to the base tree. Node handles and
+* merge only accept AggregateNodes, i.e. nodes from another
+* AggregateTree; the plain AVLTree overloads are deleted.
+*/
+template <class Key, class Value, class Aggregate = SumAggregate<Value>, class Compare = std::less<Key> >
+class AggregateTree : public AVLTree<Key, Value, Compare>
+{
+public:
+    typedef typename AVLTree<Key, Value, Compare>::finger finger;
+    typedef AVLNodeHandle<Key, Value, AggregateNode<Key, Value> > node_type;
+
+    /**
+    * A read-only iterator: a value changed behind the tree's back would
+    * leave the summaries above it stale.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        const std::pair<const Key,Value>& operator*() const;
+        const std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class AggregateTree<Key, Value, Aggregate, Compare>;
+        iterator(typename AVLTree<Key, Value, Compare>::iterator it);
+
+        typename AVLTree<Key, Value, Compare>::iterator it_;
+    };
+
+    struct insert_return_type
+    {
+        iterator position;
+        bool inserted;
+        node_type node;
+    };
+
+    AggregateTree();
+    explicit AggregateTree(const Compare& comp);
+
+    using AVLTree<Key, Value, Compare>::insert;
+    insert_return_type insert(node_type&& nh);
+    void insert(typename AVLTree<Key, Value, Compare>::node_type&& nh) = delete;
+    node_type extract(const Key& key);
+    void update(iterator pos, const Value& value);
+
+    Value aggregate() const;
+    Value aggregate(const Key& lo, const Key& hi) const;
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+    iterator min() const;
+    iterator max() const;
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator find(const K& key) const;
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator lower_bound(const K& key) const;
+    iterator find(finger& f, const Key& key) const;
+    iterator lower_bound(finger& f, const Key& key) const;
+    Value const & operator[](const Key& key) const;
+
+    // The base tree's walks, with f (or map) given const items.
+    template<typename F>
+    void for_each(F f) const;
+    template<typename F>
+    void for_each_range(const Key& lo, const Key& hi, F f) const;
+    template<typename F>
+    bool visit(F f) const;
+    template<typename F>
+    void parallel_for_each(F f, unsigned threads = defaultThreadCount()) const;
+    template<typename F>
+    void parallel_for_each_range(const Key& lo, const Key& hi, F f, unsigned threads = defaultThreadCount()) const;
+    template<typename T, typename Map, typename Combine>
+    T parallel_reduce(const T& identity, Map map, Combine combine, unsigned threads = defaultThreadCount()) const;
+    template<typename T, typename Map, typename Combine>
+    T parallel_reduce_range(const Key& lo, const Key& hi, const T& identity, Map map, Combine combine,
+        unsigned threads = defaultThreadCount()) const;
+
+    void merge(AggregateTree<Key, Value, Aggregate, Compare>& source);
+    void merge(AVLTree<Key, Value, Compare>& source) = delete;
+
+protected:
+    typedef std::pair<const Key, Value> Item;
+
+    virtual AVLNode<Key, Value>* createNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    virtual void updateNode(AVLNode<Key, Value>* n);
+    virtual size_t nodeBytes() const;
+    virtual bool checkNode(const Node<Key, Value>* n, int leftHeight, int rightHeight) const;
+
+    // Helper functions
+    AggregateNode<Key, Value>* getRoot() const;
+    static Value ownValue(const AggregateNode<Key, Value>* n);
+    static Value summaryOf(const AggregateNode<Key, Value>* n);
+};
+
+/*
+--------------------------------------------------------------
+Begin implementations for the AggregateTree::iterator class.
+---------------------------------------------------------------
+*/
+
+template<class Key, class Value, class Aggregate, class Compare>
+AggregateTree<Key, Value, Aggregate, Compare>::iterator::iterator() :
+    it_()
+{
+
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+AggregateTree<Key, Value, Aggregate, Compare>::iterator::iterator(
+    typename AVLTree<Key, Value, Compare>::iterator it) :
+    it_(it)
+{
+
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+const std::pair<const Key,Value>&
+AggregateTree<Key, Value, Aggregate, Compare>::iterator::operator*() const
+{
+    return *it_;
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+const std::pair<const Key,Value>*
+AggregateTree<Key, Value, Aggregate, Compare>::iterator::operator->() const
+{
+    return &(*it_);
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+bool AggregateTree<Key, Value, Aggregate, Compare>::iterator::operator==(const iterator& rhs) const
+{
+    return it_ == rhs.it_;
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+bool AggregateTree<Key, Value, Aggregate, Compare>::iterator::operator!=(const iterator& rhs) const
+{
+    return it_ != rhs.it_;
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+typename AggregateTree<Key, Value, Aggregate, Compare>::iterator&
+AggregateTree<Key, Value, Aggregate, Compare>::iterator::operator++()
+{
+    ++it_;
+    return *this;
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the AggregateTree::iterator class.
+-------------------------------------------------------------
+*/
+
+template<class Key, class Value, class Aggregate, class Compare>
+AggregateTree<Key, Value, Aggregate, Compare>::AggregateTree() :
+    AVLTree<Key, Value, Compare>()
+{
+    this->augmented_ = true;
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+AggregateTree<Key, Value, Aggregate, Compare>::AggregateTree(const Compare& comp) :
+    AVLTree<Key, Value, Compare>(comp)
+{
+    this->augmented_ = true;
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+AggregateNode<Key, Value>* AggregateTree<Key, Value, Aggregate, Compare>::getRoot() const
+{
+    return static_cast<AggregateNode<Key, Value>*>(this->root_);
+}
+
+/**
+* A tombstone's own value no longer counts.
+*/
+template<class Key, class Value, class Aggregate, class Compare>
+Value AggregateTree<Key, Value, Aggregate, Compare>::ownValue(const AggregateNode<Key, Value>* n)
+{
+    return n->isTombstone() ? Aggregate::identity() : n->getValue();
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+Value AggregateTree<Key, Value, Aggregate, Compare>::summaryOf(const AggregateNode<Key, Value>* n)
+{
+    return n == NULL ? Aggregate::identity() : n->getSummary();
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+AVLNode<Key, Value>* AggregateTree<Key, Value, Aggregate, Compare>::createNode(const Key& key, const Value& value,
+    AVLNode<Key, Value>* parent)
+{
+    return new AggregateNode<Key, Value>(key, value, static_cast<AggregateNode<Key, Value>*>(parent));
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+size_t AggregateTree<Key, Value, Aggregate, Compare>::nodeBytes() const
+{
+    return sizeof(AggregateNode<Key, Value>);
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+void AggregateTree<Key, Value, Aggregate, Compare>::updateNode(AVLNode<Key, Value>* n)
+{
+    AggregateNode<Key, Value>* node = static_cast<AggregateNode<Key, Value>*>(n);
+    node->setSummary(Aggregate::combine(summaryOf(node->getLeft()),
+        Aggregate::combine(ownValue(node), summaryOf(node->getRight()))));
+}
+
+/**
+* Recomputes the node's summary and compares, on top of the AVL
+* invariants, so validate() also catches a stale summary.
+*/
+template<class Key, class Value, class Aggregate, class Compare>
+bool AggregateTree<Key, Value, Aggregate, Compare>::checkNode(const Node<Key, Value>* n, int leftHeight,
+    int rightHeight) const
+{
+    if (!AVLTree<Key, Value, Compare>::checkNode(n, leftHeight, rightHeight)) {
+        return false;
+    }
+    const AggregateNode<Key, Value>* node = static_cast<const AggregateNode<Key, Value>*>(n);
+    return node->getSummary() == Aggregate::combine(summaryOf(node->getLeft()),
+        Aggregate::combine(ownValue(node), summaryOf(node->getRight())));
+}
+
+/**
+* Sets the value at pos and recomputes the summaries above it, in
+* O(log n) without searching for the key again.
+*/
+template<class Key, class Value, class Aggregate, class Compare>
+void AggregateTree<Key, Value, Aggregate, Compare>::update(iterator pos, const Value& value)
+{
+    this->overwriteNode(this->iteratorNode(pos.it_), value);
+}
+
+/**
+* Aggregate of every value in the tree.
+*/
+template<class Key, class Value, class Aggregate, class Compare>
+Value AggregateTree<Key, Value, Aggregate, Compare>::aggregate() const
+{
+    return summaryOf(getRoot());
+}
+
+/**
+* Aggregate of the values of all keys k with lo <= k < hi, in key order.
+* Descends to the highest node inside the range, then down each of its
+* sides, picking up whole subtrees that lie inside the range.
+*/
+template<class Key, class Value, class Aggregate, class Compare>
+Value AggregateTree<Key, Value, Aggregate, Compare>::aggregate(const Key& lo, const Key& hi) const
+{
+    const Compare& comp = this->comp_;
+    AggregateNode<Key, Value>* split = getRoot();
+    while (split != NULL) {
+        if (comp(split->getKey(), lo)) {
+            split = split->getRight();
+        }
+        else if (!comp(split->getKey(), hi)) {
+            split = split->getLeft();
+        }
+        else {
+            break;
+        }
+    }
+    if (split == NULL) {
+        return Aggregate::identity();
+    }
+
+    // keys >= lo below the split, gathered right to left
+    Value left = Aggregate::identity();
+    for (AggregateNode<Key, Value>* n = split->getLeft(); n != NULL; ) {
+        if (comp(n->getKey(), lo)) {
+            n = n->getRight();
+        }
+        else {
+            left = Aggregate::combine(ownValue(n), Aggregate::combine(summaryOf(n->getRight()), left));
+            n = n->getLeft();
+        }
+    }
+
+    // keys < hi below the split, gathered left to right
+    Value right = Aggregate::identity();
+    for (AggregateNode<Key, Value>* n = split->getRight(); n != NULL; ) {
+        if (comp(n->getKey(), hi)) {
+            right = Aggregate::combine(right, Aggregate::combine(summaryOf(n->getLeft()), ownValue(n)));
+            n = n->getRight();
+        }
+        else {
+            n = n->getLeft();
+        }
+    }
+
+    return Aggregate::combine(left, Aggregate::combine(ownValue(split), right));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Aggregate, class Compare>
+Value const & AggregateTree<Key, Value, Aggregate, Compare>::operator[](const Key& key) const
+{
+    return BinarySearchTree<Key, Value, Compare>::operator[](key);
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+typename AggregateTree<Key, Value, Aggregate, Compare>::iterator
+AggregateTree<Key, Value, Aggregate, Compare>::begin() const
+{
+    return iterator(AVLTree<Key, Value, Compare>::begin());
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+typename AggregateTree<Key, Value, Aggregate, Compare>::iterator
+AggregateTree<Key, Value, Aggregate, Compare>::end() const
+{
+    return iterator(AVLTree<Key, Value, Compare>::end());
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+typename AggregateTree<Key, Value, Aggregate, Compare>::iterator
+AggregateTree<Key, Value, Aggregate, Compare>::find(const Key& key) const
+{
+    return iterator(AVLTree<Key, Value, Compare>::find(key));
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+typename AggregateTree<Key, Value, Aggregate, Compare>::iterator
+AggregateTree<Key, Value, Aggregate, Compare>::lower_bound(const Key& key) const
+{
+    return iterator(AVLTree<Key, Value, Compare>::lower_bound(key));
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+typename AggregateTree<Key, Value, Aggregate, Compare>::iterator
+AggregateTree<Key, Value, Aggregate, Compare>::min() const
+{
+    return iterator(AVLTree<Key, Value, Compare>::min());
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+typename AggregateTree<Key, Value, Aggregate, Compare>::iterator
+AggregateTree<Key, Value, Aggregate, Compare>::max() const
+{
+    return iterator(AVLTree<Key, Value, Compare>::max());
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+template<typename K, typename C, typename>
+typename AggregateTree<Key, Value, Aggregate, Compare>::iterator
+AggregateTree<Key, Value, Aggregate, Compare>::find(const K& key) const
+{
+    return iterator(AVLTree<Key, Value, Compare>::find(key));
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+template<typename K, typename C, typename>
+typename AggregateTree<Key, Value, Aggregate, Compare>::iterator
+AggregateTree<Key, Value, Aggregate, Compare>::lower_bound(const K& key) const
+{
+    return iterator(AVLTree<Key, Value, Compare>::lower_bound(key));
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+typename AggregateTree<Key, Value, Aggregate, Compare>::iterator
+AggregateTree<Key, Value, Aggregate, Compare>::find(finger& f, const Key& key) const
+{
+    return iterator(AVLTree<Key, Value, Compare>::find(f, key));
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+typename AggregateTree<Key, Value, Aggregate, Compare>::iterator
+AggregateTree<Key, Value, Aggregate, Compare>::lower_bound(finger& f, const Key& key) const
+{
+    return iterator(AVLTree<Key, Value, Compare>::lower_bound(f, key));
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+template<typename F>
+void AggregateTree<Key, Value, Aggregate, Compare>::for_each(F f) const
+{
+    AVLTree<Key, Value, Compare>::for_each([&f](const Item& item) { f(item); });
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+template<typename F>
+void AggregateTree<Key, Value, Aggregate, Compare>::for_each_range(const Key& lo, const Key& hi, F f) const
+{
+    AVLTree<Key, Value, Compare>::for_each_range(lo, hi, [&f](const Item& item) { f(item); });
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+template<typename F>
+bool AggregateTree<Key, Value, Aggregate, Compare>::visit(F f) const
+{
+    return AVLTree<Key, Value, Compare>::visit([&f](const Item& item) { return f(item); });
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+template<typename F>
+void AggregateTree<Key, Value, Aggregate, Compare>::parallel_for_each(F f, unsigned threads) const
+{
+    AVLTree<Key, Value, Compare>::parallel_for_each([&f](const Item& item) { f(item); }, threads);
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+template<typename F>
+void AggregateTree<Key, Value, Aggregate, Compare>::parallel_for_each_range(const Key& lo, const Key& hi, F f,
+    unsigned threads) const
+{
+    AVLTree<Key, Value, Compare>::parallel_for_each_range(lo, hi, [&f](const Item& item) { f(item); }, threads);
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+template<typename T, typename Map, typename Combine>
+T AggregateTree<Key, Value, Aggregate, Compare>::parallel_reduce(const T& identity, Map map, Combine combine,
+    unsigned threads) const
+{
+    return AVLTree<Key, Value, Compare>::parallel_reduce(identity,
+        [&map](const Item& item) { return map(item); }, combine, threads);
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+template<typename T, typename Map, typename Combine>
+T AggregateTree<Key, Value, Aggregate, Compare>::parallel_reduce_range(const Key& lo, const Key& hi,
+    const T& identity, Map map, Combine combine, unsigned threads) const
+{
+    return AVLTree<Key, Value, Compare>::parallel_reduce_range(lo, hi, identity,
+        [&map](const Item& item) { return map(item); }, combine, threads);
+}
+
+/**
+* Links the handle's node in and recomputes the summaries above it, so
+* the handle may come from a tree with another Aggregate policy.
+*/
+template<class Key, class Value, class Aggregate, class Compare>
+typename AggregateTree<Key, Value, Aggregate, Compare>::insert_return_type
+AggregateTree<Key, Value, Aggregate, Compare>::insert(node_type&& nh)
+{
+    typename AVLTree<Key, Value, Compare>::template basic_insert_return_type<node_type> result =
+        this->insertHandle(std::move(nh));
+    insert_return_type ret = { iterator(result.position), result.inserted, std::move(result.node) };
+    return ret;
+}
+
+template<class Key, class Value, class Aggregate, class Compare>
+typename AggregateTree<Key, Value, Aggregate, Compare>::node_type
+AggregateTree<Key, Value, Aggregate, Compare>::extract(const Key& key)
+{
+    return this->template extractHandle<AggregateNode<Key, Value> >(key);
+}
+
+/**
+* Only trees with the same node type can be merged.
+*/
+template<class Key, class Value, class Aggregate, class Compare>
+void AggregateTree<Key, Value, Aggregate, Compare>::merge(AggregateTree<Key, Value, Aggregate, Compare>& source)
+{
+    AVLTree<Key, Value, Compare>::merge(source);
+}
+
+
+#endif
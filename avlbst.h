@@ -7,7 +7,9 @@
 #include <cstdlib>
 #include <cstdint>
 #include <algorithm>
+#include <vector>
 #include "bst.h"
+#include "parallel.h"
 
 struct KeyError { };
 
@@ -29,6 +31,10 @@ public:
     void setBalance (int8_t balance);
     void updateBalance(int8_t diff);
 
+    // Getter/setter for the lazy removal mark.
+    virtual bool isTombstone() const override;
+    void setTombstone(bool tombstone);
+
     // Getters for parent, left, and right. These need to be redefined since they
     // return pointers to AVLNodes - not plain Nodes. See the Node class in bst.h
     // for more information.
@@ -38,6 +44,7 @@ public:
 
 protected:
     int8_t balance_;    // effectively a signed char
+    bool tombstone_;    // removed lazily, still linked into the tree
 
 
 };
@@ -54,7 +61,7 @@ protected:
 */
 template<class Key, class Value>
 AVLNode<Key, Value>::AVLNode(const Key& key, const Value& value, AVLNode<Key, Value> *parent) :
-    Node<Key, Value>(key, value, parent), balance_(0)
+    Node<Key, Value>(key, value, parent), balance_(0), tombstone_(false)
 {
 
 }
@@ -95,6 +102,24 @@ void AVLNode<Key, Value>::updateBalance(int8_t diff)
     balance_ += diff;
 }
 
+/**
+* True once the node has been removed lazily by its tree.
+*/
+template<class Key, class Value>
+bool AVLNode<Key, Value>::isTombstone() const
+{
+    return tombstone_;
+}
+
+/**
+* A setter for the lazy removal mark.
+*/
+template<class Key, class Value>
+void AVLNode<Key, Value>::setTombstone(bool tombstone)
+{
+    tombstone_ = tombstone;
+}
+
 /**
 * An overridden function for getting the parent since a static_cast is necessary to make sure
 * that our node is a AVLNode.
@@ -130,85 +155,361 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
   -----------------------------------------------
 */
 
+/**
+* One entry of a batch for AVLTree::apply_batch: an upsert of
+* (key, value), or a removal of key when remove is set.
+*/
+template <typename Key, typename Value>
+struct BatchOp
+{
+    Key key;
+    Value value;
+    bool remove;
+
+    static BatchOp upsert(const Key& key, const Value& value)
+    {
+        BatchOp op = { key, value, false };
+        return op;
+    }
+    static BatchOp erase(const Key& key)
+    {
+        BatchOp op = { key, Value(), true };
+        return op;
+    }
+};
+
 
-template <class Key, class Value>
-class AVLTree : public BinarySearchTree<Key, Value>
+template <class Key, class Value, class Compare> class AVLTree;
+
+/**
+* Owns a node taken out of an AVLTree by extract, so that it can be
+* linked into another tree by insert without copying the item or
+* freeing and reallocating the node. Move-only, like std::map's
+* node_type; a handle that still owns its node frees it on destruction.
+*
+* NodeType is the tree's node class, so that each tree type has its own
+* handle type and a handle from a plain AVLTree cannot be inserted into
+* a tree whose nodes carry extra fields (AggregateTree, IntervalTree).
+*/
+template <typename Key, typename Value, typename NodeType = AVLNode<Key, Value> >
+class AVLNodeHandle
 {
 public:
+    AVLNodeHandle();
+    AVLNodeHandle(AVLNodeHandle&& other);
+    AVLNodeHandle& operator=(AVLNodeHandle&& other);
+    ~AVLNodeHandle();
+
+    bool empty() const;
+    explicit operator bool() const;
+    const Key& key() const;
+    Value& mapped() const;
+
+private:
+    template <class K, class V, class C> friend class AVLTree;
+    explicit AVLNodeHandle(NodeType* node);
+    NodeType* release();
+
+    AVLNodeHandle(const AVLNodeHandle&);
+    AVLNodeHandle& operator=(const AVLNodeHandle&);
+
+    NodeType* node_;
+};
+
+template<class Key, class Value, class NodeType>
+AVLNodeHandle<Key, Value, NodeType>::AVLNodeHandle() :
+    node_(NULL)
+{
+
+}
+
+template<class Key, class Value, class NodeType>
+AVLNodeHandle<Key, Value, NodeType>::AVLNodeHandle(NodeType* node) :
+    node_(node)
+{
+
+}
+
+template<class Key, class Value, class NodeType>
+AVLNodeHandle<Key, Value, NodeType>::AVLNodeHandle(AVLNodeHandle&& other) :
+    node_(other.node_)
+{
+    other.node_ = NULL;
+}
+
+template<class Key, class Value, class NodeType>
+AVLNodeHandle<Key, Value, NodeType>& AVLNodeHandle<Key, Value, NodeType>::operator=(AVLNodeHandle&& other)
+{
+    if (this != &other) {
+        delete node_;
+        node_ = other.node_;
+        other.node_ = NULL;
+    }
+    return *this;
+}
+
+template<class Key, class Value, class NodeType>
+AVLNodeHandle<Key, Value, NodeType>::~AVLNodeHandle()
+{
+    delete node_;
+}
+
+template<class Key, class Value, class NodeType>
+bool AVLNodeHandle<Key, Value, NodeType>::empty() const
+{
+    return node_ == NULL;
+}
+
+template<class Key, class Value, class NodeType>
+AVLNodeHandle<Key, Value, NodeType>::operator bool() const
+{
+    return node_ != NULL;
+}
+
+/**
+* @precondition The handle is not empty
+*/
+template<class Key, class Value, class NodeType>
+const Key& AVLNodeHandle<Key, Value, NodeType>::key() const
+{
+    return node_->getKey();
+}
+
+/**
+* @precondition The handle is not empty
+*/
+template<class Key, class Value, class NodeType>
+Value& AVLNodeHandle<Key, Value, NodeType>::mapped() const
+{
+    return node_->getValue();
+}
+
+/**
+* Gives up ownership of the node without freeing it.
+*/
+template<class Key, class Value, class NodeType>
+NodeType* AVLNodeHandle<Key, Value, NodeType>::release()
+{
+    NodeType* node = node_;
+    node_ = NULL;
+    return node;
+}
+
+
+/**
+* An AVL tree.
+*
+* With lazy removal enabled (setLazyRemove), remove only marks the node
+* as a tombstone after the usual O(log n) lookup: nothing is unlinked,
+* freed or rebalanced. Lookups and iteration skip tombstones, insert
+* revives them, and once tombstones make up more than the configured
+* fraction of the nodes they are all purged at once by compact(), which
+* rebuilds the tree in O(n). Callers may also run compact() themselves
+* at a quiet moment.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class AVLTree : public BinarySearchTree<Key, Value, Compare>
+{
+public:
+    typedef typename BinarySearchTree<Key, Value, Compare>::iterator iterator;
+    typedef AVLNodeHandle<Key, Value> node_type;
+
+    /**
+    * Result of inserting a node handle: where the key is, whether the
+    * handle's node was linked in, and the handle itself when it was not.
+    */
+    template <class Handle>
+    struct basic_insert_return_type
+    {
+        iterator position;
+        bool inserted;
+        Handle node;
+    };
+    typedef basic_insert_return_type<node_type> insert_return_type;
+
+    AVLTree();
+    explicit AVLTree(const Compare& comp);
+
+    using BinarySearchTree<Key, Value, Compare>::insert;
     virtual void insert (const std::pair<const Key, Value> &new_item); // TODO
-    virtual void remove(const Key& key);  // TODO
+    insert_return_type insert(node_type&& nh);
+    node_type extract(const Key& key);
+    void merge(AVLTree<Key, Value, Compare>& source);
+    virtual void clear();
+
+    void apply_batch(std::vector<BatchOp<Key, Value> >&& ops);
+
+    void setLazyRemove(bool enabled, double maxTombstoneFraction = 0.25);
+    bool getLazyRemove() const;
+    size_t getTombstoneCount() const;
+    void compact();
 protected:
     virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
 
     // Add helper functions here
     AVLNode<Key, Value>* getSuccessor(AVLNode<Key, Value>* node);
+    AVLNode<Key, Value>* findInsertPos(const Key& key, AVLNode<Key, Value>*& parent, int& cmp);
+    void attachNode(AVLNode<Key, Value>* new_node, AVLNode<Key, Value>* parent, int cmp);
+    AVLNode<Key, Value>* unlinkNode(AVLNode<Key, Value>* node);
+    bool linkNode(AVLNode<Key, Value>* node);
+    template <class NodeType>
+    AVLNodeHandle<Key, Value, NodeType> extractHandle(const Key& key);
+    template <class NodeType>
+    basic_insert_return_type<AVLNodeHandle<Key, Value, NodeType> >
+    insertHandle(AVLNodeHandle<Key, Value, NodeType>&& nh);
+    virtual AVLNode<Key, Value>* createNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    virtual void updateNode(AVLNode<Key, Value>* n);
+    virtual Node<Key, Value>* linkLeaf(const std::pair<const Key, Value>& keyValuePair, Node<Key, Value>* parent,
+        int cmp);
+    virtual void overwriteNode(Node<Key, Value>* n, const Value& value);
+    virtual void removeNode(Node<Key, Value>* n);
+    virtual void eraseNode(Node<Key, Value>* n);
+    void refreshPath(AVLNode<Key, Value>* n);
+    void replaceNode(AVLNode<Key, Value>* old_node, AVLNode<Key, Value>* new_node);
     void rotateLeft (AVLNode<Key, Value> *n);
     void rotateRight (AVLNode<Key, Value> *n);
     void insertFix(AVLNode<Key, Value> *parent, AVLNode<Key, Value>* child);
     void removeFix(AVLNode<Key, Value> *n, int diff);
+    void collectNodes(std::vector<AVLNode<Key, Value>*>& nodes, bool purgeTombstones);
+    AVLNode<Key, Value>* buildBalanced(std::vector<AVLNode<Key, Value>*>& nodes,
+        size_t lo, size_t hi, AVLNode<Key, Value>* parent, int& height);
+    void rebuild(std::vector<AVLNode<Key, Value>*>& nodes);
+    virtual bool checkNode(const Node<Key, Value>* n, int leftHeight, int rightHeight) const;
+    virtual size_t nodeBytes() const;
+    virtual size_t linkedNodes() const;
+
+    bool lazyRemove_;
+    double maxTombstoneFraction_;
+    size_t tombstones_;
+    bool augmented_;    // set by subclasses whose nodes carry subtree summaries
 };
 
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::AVLTree() :
+    BinarySearchTree<Key, Value, Compare>(),
+    lazyRemove_(false), maxTombstoneFraction_(0.25), tombstones_(0), augmented_(false)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::AVLTree(const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(comp),
+    lazyRemove_(false), maxTombstoneFraction_(0.25), tombstones_(0), augmented_(false)
+{
+
+}
+
 /*
  * Recall: If key is already in the tree, you should 
  * overwrite the current value with the updated value.
  */
-template<class Key, class Value>
-void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::insert (const std::pair<const Key, Value> &new_item)
 {
-
-    AVLNode<Key,Value>* new_node = new AVLNode<Key,Value>(new_item.first, new_item.second, NULL);
-    new_node->setBalance(0);   
-    new_node->setRight(NULL);
-    new_node->setLeft(NULL);
-
-    if (this->root_ == NULL) {
-        this->root_ = new_node;
+    AVLNode<Key, Value>* parent;
+    int cmp;
+    AVLNode<Key, Value>* existing = findInsertPos(new_item.first, parent, cmp);
+    if (existing != NULL) {
+        overwriteNode(existing, new_item.second);
         return;
     }
+    attachNode(createNode(new_item.first, new_item.second, parent), parent, cmp);
+}
 
-    AVLNode<Key,Value> *parent = NULL;
+/**
+* Sets the value of an existing node, bringing it back to life if it
+* was lazily removed.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::overwriteNode(Node<Key, Value>* n, const Value& value)
+{
+    AVLNode<Key, Value>* node = static_cast<AVLNode<Key, Value>*>(n);
+    node->setValue(value);
+    if (node->isTombstone()) {
+        node->setTombstone(false);
+        --tombstones_;
+        ++this->size_;
+    }
+    refreshPath(node);
+}
+
+template<class Key, class Value, class Compare>
+Node<Key, Value>* AVLTree<Key, Value, Compare>::linkLeaf(const std::pair<const Key, Value>& keyValuePair,
+    Node<Key, Value>* parent, int cmp)
+{
+    AVLNode<Key, Value>* avlParent = static_cast<AVLNode<Key, Value>*>(parent);
+    AVLNode<Key, Value>* node = createNode(keyValuePair.first, keyValuePair.second, avlParent);
+    attachNode(node, avlParent, cmp);
+    return node;
+}
+
+/**
+* Descends toward key. Returns the node holding key (which may be a
+* tombstone), or NULL after setting parent and cmp to where a new node
+* for key would be attached.
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::findInsertPos(const Key& key,
+    AVLNode<Key, Value>*& parent, int& cmp)
+{
+    parent = NULL;
+    cmp = 0;
     AVLNode<Key,Value>* next = static_cast<AVLNode<Key,Value>*>(this->root_);
+    const typename AVLTree<Key, Value, Compare>::KeyPrefix prefix = this->probePrefix(key);
 
-    while (true){
-        parent = next;
-        if (new_item.first  == parent->getKey()){
-            parent->setValue(new_item.second);
-            return;
-        }
-        else if (new_item.first < parent->getKey()) {
-            if (parent->getLeft() == NULL) {
-                parent->setLeft(new_node);
-                new_node->setParent(parent);
-                break;
-            }
-            next = parent->getLeft();
-        } 
-        else {
-            if (parent->getRight() == NULL) {
-                parent->setRight(new_node);
-                new_node->setParent(parent);
-                break;
-            }
-            next = parent->getRight();
+    while (next != NULL) {
+        cmp = this->compareToNode(key, prefix, next);
+        if (cmp == 0) {
+            return next;
         }
+        parent = next;
+        next = (cmp < 0) ? next->getLeft() : next->getRight();
     }
+    return NULL;
+}
 
-    if (parent->getBalance() == -1 || parent->getBalance() == 1) {
-        parent->setBalance(0);
-        return;
+/**
+* Links a detached node in below parent, on the side given by cmp as
+* returned from findInsertPos, and rebalances.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::attachNode(AVLNode<Key, Value>* new_node,
+    AVLNode<Key, Value>* parent, int cmp)
+{
+    new_node->setParent(parent);
+    ++this->size_;
+    if (parent == NULL) {
+        this->root_ = new_node;
+        this->noteLinked(new_node);
     }
     else {
-        if (parent->getLeft() == new_node){
-            parent->setBalance(-1);
+        if (cmp < 0) {
+            parent->setLeft(new_node);
         }
         else {
-            parent->setBalance(1);
+            parent->setRight(new_node);
+        }
+        this->noteLinked(new_node);
+
+        if (parent->getBalance() == -1 || parent->getBalance() == 1) {
+            parent->setBalance(0);
+        }
+        else {
+            if (parent->getLeft() == new_node){
+                parent->setBalance(-1);
+            }
+            else {
+                parent->setBalance(1);
+            }
+            insertFix(parent, new_node);
         }
-        insertFix(parent, new_node);
     }
+    refreshPath(new_node);
 }
-template<typename Key, typename Value>
-AVLNode<Key, Value>* AVLTree<Key, Value>::getSuccessor(AVLNode<Key, Value>* node) 
+
+template<typename Key, typename Value, typename Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::getSuccessor(AVLNode<Key, Value>* node) 
 {
     if (node->getRight() != NULL) {
         node = node->getRight();
@@ -226,8 +527,8 @@ AVLNode<Key, Value>* AVLTree<Key, Value>::getSuccessor(AVLNode<Key, Value>* node
         return parent;
     }
 }
-template<typename Key, typename Value>
-void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value> *parent, AVLNode<Key, Value>* child)
+template<typename Key, typename Value, typename Compare>
+void AVLTree<Key, Value, Compare>::insertFix(AVLNode<Key, Value> *parent, AVLNode<Key, Value>* child)
  {
     
     if (parent == NULL || parent->getParent() == NULL) {
@@ -318,21 +619,56 @@ void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value> *parent, AVLNode<Key, Va
 
 /*
  * Recall: The writeup specifies that if a node has 2 children you
- * should swap with the predecessor and then remove.
+ * should swap with the predecessor and then remove. remove(key) in
+ * the base class finds the node and calls this.
  */
-template<class Key, class Value>
-void AVLTree<Key, Value>:: remove(const Key& key)
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::removeNode(Node<Key, Value>* n)
 {
-        AVLNode<Key, Value>* node = static_cast<AVLNode<Key,Value>*>(this->internalFind(key));
+    AVLNode<Key, Value>* node = static_cast<AVLNode<Key,Value>*>(n);
+
+    if (lazyRemove_) {
+        node->setTombstone(true);
+        ++tombstones_;
+        --this->size_;
+        refreshPath(node);
+        if (tombstones_ > maxTombstoneFraction_ * (this->size_ + tombstones_)) {
+            compact();
+        }
+        return;
+    }
 
-    if (node == NULL) {
-        return;  // the value is not in the BST
+    delete unlinkNode(node);
+}
+
+/**
+* Unlinks n even with lazy removal on. A tombstone is no longer counted
+* in size_, which unlinkNode decrements.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::eraseNode(Node<Key, Value>* n)
+{
+    AVLNode<Key, Value>* node = static_cast<AVLNode<Key,Value>*>(n);
+    if (node->isTombstone()) {
+        --tombstones_;
+        ++this->size_;
     }
+    delete unlinkNode(node);
+}
 
+/**
+* Takes a live node out of the tree and rebalances, leaving the node
+* detached (no links, balance 0) and returning it.
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::unlinkNode(AVLNode<Key, Value>* node)
+{
+    this->forgetNode(node);
     if (node->getLeft() != NULL && node->getRight() != NULL) {
         AVLNode<Key, Value>* successor = getSuccessor(node);
         nodeSwap(node, successor);
     }
+    this->noteUnlinking(node);
 
     AVLNode<Key, Value> *child = node->getLeft();
     if (node->getRight() != NULL) {
@@ -344,7 +680,7 @@ void AVLTree<Key, Value>:: remove(const Key& key)
         child->setParent(parent);
     }
 
-    int diff;
+    int diff = 0;
     if (parent == NULL) {
         this->root_ = child;
     } 
@@ -358,14 +694,23 @@ void AVLTree<Key, Value>:: remove(const Key& key)
             diff = -1;
         }
     }
-
-
-    delete node;
+    --this->size_;
 
     removeFix(parent, diff);
+    refreshPath(parent);
+
+    node->setParent(NULL);
+    node->setLeft(NULL);
+    node->setRight(NULL);
+    node->setBalance(0);
+    return node;
 }
-template<typename Key, typename Value>
-void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* n, int diff)
+/**
+* Walks up from n after one of its subtrees got shorter. diff is +1 when
+* the left subtree shrank and -1 when the right one did.
+*/
+template<typename Key, typename Value, typename Compare>
+void AVLTree<Key, Value, Compare>::removeFix(AVLNode<Key, Value>* n, int diff)
 {
     if (n == NULL){
         return;
@@ -380,20 +725,17 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* n, int diff)
     }
 
     if (n->getBalance() + diff == -2){
-
         c = n->getLeft();
-        if (c->getBalance() == -1 || c->getBalance() == 0){
+        if (c->getBalance() == -1){
             rotateRight(n);
-            if(c->getBalance() == -1){
-                n->setBalance(0);
-                c->setBalance(0);
-                removeFix(p,ndiff);
-            }
-            if(c->getBalance() == 0){
-                n->setBalance(-1);
-                c->setBalance(1);
-                return;
-            }
+            n->setBalance(0);
+            c->setBalance(0);
+            removeFix(p,ndiff);
+        }
+        else if (c->getBalance() == 0){
+            rotateRight(n);
+            n->setBalance(-1);
+            c->setBalance(1);
         }
         else{
             AVLNode<Key, Value>* g = c->getRight();
@@ -402,147 +744,572 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* n, int diff)
             if (g->getBalance() == 1){
                 n->setBalance(0);
                 c->setBalance(-1);
-                g->setBalance(0);
             }
-            if(g->getBalance() == 0){
+            else if (g->getBalance() == 0){
                 n->setBalance(0);
                 c->setBalance(0);
-                g->setBalance(0);
             }
-            if (g->getBalance() == 1){
+            else{
                 n->setBalance(1);
                 c->setBalance(0);
-                g->setBalance(0);
             }
+            g->setBalance(0);
             removeFix(p,ndiff);
         }
     }
-    else if (n->getBalance() == 0){
-        n->setBalance(n->getBalance() + diff);
-        return;
-    }
-    else{
-        n->setBalance(0);
-        removeFix(p,ndiff);
-    }
-
-
-    if (n->getBalance() + diff == 2){
-
+    else if (n->getBalance() + diff == 2){
         c = n->getRight();
-        if (c->getBalance() == 1 || c->getBalance() == 0){
+        if (c->getBalance() == 1){
             rotateLeft(n);
-            if(c->getBalance() == 1){
-                n->setBalance(0);
-                c->setBalance(0);
-                removeFix(p,ndiff);
-            }
-            if(c->getBalance() == 0){
-                n->setBalance(1);
-                c->setBalance(-1);
-                return;
-            }
+            n->setBalance(0);
+            c->setBalance(0);
+            removeFix(p,ndiff);
+        }
+        else if (c->getBalance() == 0){
+            rotateLeft(n);
+            n->setBalance(1);
+            c->setBalance(-1);
         }
         else{
             AVLNode<Key, Value>* g = c->getLeft();
             rotateRight(c);
-            rotateLeft(n);            
+            rotateLeft(n);
             if (g->getBalance() == -1){
                 n->setBalance(0);
                 c->setBalance(1);
-                g->setBalance(0);
             }
-            if(g->getBalance() == 0){
+            else if (g->getBalance() == 0){
                 n->setBalance(0);
                 c->setBalance(0);
-                g->setBalance(0);
             }
-            if (g->getBalance() == -1){
+            else{
                 n->setBalance(-1);
                 c->setBalance(0);
-                g->setBalance(0);
             }
+            g->setBalance(0);
             removeFix(p,ndiff);
         }
     }
     else if (n->getBalance() == 0){
-        n->setBalance(n->getBalance() + diff);
-        return;
+        // height is unchanged, only the balance shifts
+        n->setBalance(diff);
     }
     else{
+        // the taller side lost a level, so the whole subtree got shorter
         n->setBalance(0);
         removeFix(p,ndiff);
     }
+}
+
+/**
+* Rotates n down and to the left
+*/
+template<typename Key, typename Value, typename Compare>
+void AVLTree<Key, Value, Compare>::rotateLeft (AVLNode<Key, Value> *n)
+{
+    BinarySearchTree<Key, Value, Compare>::rotateLeft(n);
+    if (augmented_) {
+        updateNode(n);
+        updateNode(n->getParent());
+    }
+}
+
+/**
+* Rotates n down and to the right
+*/
+template<typename Key, typename Value, typename Compare>
+void AVLTree<Key, Value, Compare>::rotateRight (AVLNode<Key, Value> *n)
+{
+    BinarySearchTree<Key, Value, Compare>::rotateRight(n);
+    if (augmented_) {
+        updateNode(n);
+        updateNode(n->getParent());
+    }
+}
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
+{
+    BinarySearchTree<Key, Value, Compare>::nodeSwap(n1, n2);
+    int8_t tempB = n1->getBalance();
+    n1->setBalance(n2->getBalance());
+    n2->setBalance(tempB);
+}
 
 
+/**
+* Allocates a node for a new key. Subclasses that use a richer node
+* type override this.
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::createNode(const Key& key, const Value& value,
+    AVLNode<Key, Value>* parent)
+{
+    return new AVLNode<Key, Value>(key, value, parent);
 }
-template<typename Key, typename Value>
-void AVLTree<Key, Value>::rotateLeft (AVLNode<Key, Value> *n)
+
+/**
+* Recomputes whatever n summarizes about its subtree from its own item
+* and its children. Does nothing here; subclasses that set augmented_
+* override it, and the tree then calls it after every rotation, on each
+* node of a rebuild, and along the path above any changed node.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::updateNode(AVLNode<Key, Value>* n)
 {
-    AVLNode<Key, Value>* y = n->getRight();
-    AVLNode<Key, Value>* rootParent = n->getParent();
-    y->setParent(rootParent);
 
-    //set the root parent
-    if (n->getParent() == NULL) {        
-        this->root_ = n->getRight();
+}
+
+/**
+* Calls updateNode on n and each of its ancestors, bottom up.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::refreshPath(AVLNode<Key, Value>* n)
+{
+    if (!augmented_) {
+        return;
     }
-    else if (rootParent->getRight() == n){
-        rootParent->setRight(y);
+    while (n != NULL) {
+        updateNode(n);
+        n = n->getParent();
     }
-    else{
-        rootParent->setLeft(y);
-    }    
+}
 
-    //pointer shifts
-    AVLNode<Key, Value>* c = y->getLeft();
+/**
+* Unlinks the item with the given key and hands its node to the caller,
+* or returns an empty handle if the key is not in the tree. Nothing is
+* copied or freed.
+*/
+template<class Key, class Value, class Compare>
+typename AVLTree<Key, Value, Compare>::node_type
+AVLTree<Key, Value, Compare>::extract(const Key& key)
+{
+    return extractHandle<AVLNode<Key, Value> >(key);
+}
+
+/**
+* Links the handle's node into the tree without allocating. If the key
+* is already present the tree is left alone and the node stays in the
+* returned handle. An empty handle inserts nothing.
+*/
+template<class Key, class Value, class Compare>
+typename AVLTree<Key, Value, Compare>::insert_return_type
+AVLTree<Key, Value, Compare>::insert(node_type&& nh)
+{
+    return insertHandle(std::move(nh));
+}
 
-    y->setLeft(n);
-    n->setParent(y);
-    n->setRight(c);
-    if (c != NULL){
-        c->setParent(n);
+/**
+* extract for a tree whose nodes are NodeType; see extract.
+*/
+template<class Key, class Value, class Compare>
+template<class NodeType>
+AVLNodeHandle<Key, Value, NodeType> AVLTree<Key, Value, Compare>::extractHandle(const Key& key)
+{
+    AVLNode<Key, Value>* node = static_cast<AVLNode<Key,Value>*>(this->internalFind(key));
+    if (node == NULL) {
+        return AVLNodeHandle<Key, Value, NodeType>();
     }
-    
+    return AVLNodeHandle<Key, Value, NodeType>(static_cast<NodeType*>(unlinkNode(node)));
 }
 
 /**
-* Rotates n down and to the right
+* insert(node_type&&) for a tree whose nodes are NodeType; see insert.
 */
-template<typename Key, typename Value>
-void AVLTree<Key, Value>::rotateRight (AVLNode<Key, Value> *n)
+template<class Key, class Value, class Compare>
+template<class NodeType>
+typename AVLTree<Key, Value, Compare>::template basic_insert_return_type<AVLNodeHandle<Key, Value, NodeType> >
+AVLTree<Key, Value, Compare>::insertHandle(AVLNodeHandle<Key, Value, NodeType>&& nh)
 {
-    AVLNode<Key, Value>* y = n->getLeft();
-    AVLNode<Key, Value>* rootParent = n->getParent();
+    basic_insert_return_type<AVLNodeHandle<Key, Value, NodeType> > result;
+    result.inserted = false;
+    if (nh.empty()) {
+        result.position = this->end();
+        return result;
+    }
+    NodeType* node = nh.node_;
+    if (linkNode(node)) {
+        nh.release();
+        result.position = this->makeIterator(node);
+        result.inserted = true;
+        return result;
+    }
+    result.position = this->find(node->getKey());
+    result.node = std::move(nh);
+    return result;
+}
 
-    y->setParent(rootParent);
-    if (n->getParent() == NULL) {        
-        this->root_= y;
+/**
+* Links a detached node into the tree unless its key is already live.
+* A tombstone with the same key is replaced by the node.
+*/
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::linkNode(AVLNode<Key, Value>* node)
+{
+    AVLNode<Key, Value>* parent;
+    int cmp;
+    AVLNode<Key, Value>* existing = findInsertPos(node->getKey(), parent, cmp);
+    if (existing == NULL) {
+        attachNode(node, parent, cmp);
+        return true;
     }
-    else if (rootParent->getRight() == n){
-        rootParent->setRight(y);
+    if (!existing->isTombstone()) {
+        return false;
     }
-    else{
-        rootParent->setLeft(y);
-    }    
+    replaceNode(existing, node);
+    refreshPath(node);
+    this->forgetNode(existing);
+    delete existing;
+    --tombstones_;
+    ++this->size_;
+    return true;
+}
 
-    AVLNode<Key, Value>* c = y->getRight();
+/**
+* Puts new_node in old_node's place in the tree, taking over its links
+* and balance. old_node is left detached.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::replaceNode(AVLNode<Key, Value>* old_node, AVLNode<Key, Value>* new_node)
+{
+    AVLNode<Key, Value>* parent = old_node->getParent();
+    new_node->setParent(parent);
+    new_node->setLeft(old_node->getLeft());
+    new_node->setRight(old_node->getRight());
+    new_node->setBalance(old_node->getBalance());
+    if (parent == NULL) {
+        this->root_ = new_node;
+    }
+    else if (parent->getLeft() == old_node) {
+        parent->setLeft(new_node);
+    }
+    else {
+        parent->setRight(new_node);
+    }
+    if (new_node->getLeft() != NULL) {
+        new_node->getLeft()->setParent(new_node);
+    }
+    if (new_node->getRight() != NULL) {
+        new_node->getRight()->setParent(new_node);
+    }
+    old_node->setParent(NULL);
+    old_node->setLeft(NULL);
+    old_node->setRight(NULL);
+    if (this->leftmost_ == old_node) {
+        this->leftmost_ = new_node;
+    }
+    if (this->rightmost_ == old_node) {
+        this->rightmost_ = new_node;
+    }
+}
 
-    y->setRight(n);
-    n->setParent(y);
-    n->setLeft(c);
-    if (c != NULL){
-        c->setParent(n);
+/**
+* Moves every node of source whose key is not already in this tree
+* over to this tree; nodes with conflicting keys stay in source. No
+* node is allocated or copied. Like apply_batch, a small source is
+* linked in one node at a time and a large one is merged in a single
+* in-order pass that rebuilds both trees balanced. Source's hot cache
+* is emptied and its fingers go stale.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::merge(AVLTree<Key, Value, Compare>& source)
+{
+    if (&source == this || source.root_ == NULL) {
+        return;
+    }
+    std::vector<AVLNode<Key, Value>*> incoming;
+    incoming.reserve(source.size_);
+    source.collectNodes(incoming, true);
+    source.forgetAllNodes();
+    source.tombstones_ = 0;
+    source.size_ = 0;
+
+    std::vector<AVLNode<Key, Value>*> leftover;
+    size_t total = this->size_ + tombstones_;
+    size_t depth = 1;
+    while ((size_t(1) << depth) <= total) {
+        ++depth;
     }
+    if (incoming.size() * depth < total) {
+        for (size_t i = 0; i < incoming.size(); ++i) {
+            AVLNode<Key, Value>* node = incoming[i];
+            node->setParent(NULL);
+            node->setLeft(NULL);
+            node->setRight(NULL);
+            node->setBalance(0);
+            if (!linkNode(node)) {
+                leftover.push_back(node);
+            }
+        }
+    }
+    else {
+        std::vector<AVLNode<Key, Value>*> nodes;
+        nodes.reserve(this->size_);
+        collectNodes(nodes, true);
+        tombstones_ = 0;
+
+        const Compare& comp = this->comp_;
+        std::vector<AVLNode<Key, Value>*> merged;
+        merged.reserve(nodes.size() + incoming.size());
+        size_t i = 0;
+        size_t j = 0;
+        while (i < nodes.size() || j < incoming.size()) {
+            if (j == incoming.size() || (i < nodes.size() && comp(nodes[i]->getKey(), incoming[j]->getKey()))) {
+                merged.push_back(nodes[i++]);
+            }
+            else if (i == nodes.size() || comp(incoming[j]->getKey(), nodes[i]->getKey())) {
+                merged.push_back(incoming[j++]);
+                ++this->size_;
+            }
+            else {
+                merged.push_back(nodes[i++]);
+                leftover.push_back(incoming[j++]);
+            }
+        }
+        rebuild(merged);
+    }
+    source.size_ = leftover.size();
+    source.rebuild(leftover);
 }
-template<class Key, class Value>
-void AVLTree<Key, Value>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
+
+/**
+* Applies a batch of upserts and removes. The batch is sorted by key
+* in place (in parallel when large), so its contents are left
+* unspecified, and when several ops name the same key the last one
+* wins. Small batches are then applied one op at a time in key order.
+* Large batches are merged with the tree's nodes in one in-order pass,
+* so existing nodes are reused and only new keys allocate, and the
+* tree is rebuilt balanced once, in O(n + m) instead of O(m log n) with
+* a rebalancing cascade per op.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::apply_batch(std::vector<BatchOp<Key, Value> >&& ops)
 {
-    BinarySearchTree<Key, Value>::nodeSwap(n1, n2);
-    int8_t tempB = n1->getBalance();
-    n1->setBalance(n2->getBalance());
-    n2->setBalance(tempB);
+    if (ops.empty()) {
+        return;
+    }
+    const Compare& comp = this->comp_;
+    parallelStableSort(ops.begin(), ops.end(),
+        [&comp](const BatchOp<Key, Value>& a, const BatchOp<Key, Value>& b) {
+            return comp(a.key, b.key);
+        });
+
+    // keep only the last op for each key
+    size_t kept = 0;
+    for (size_t i = 0; i < ops.size(); ++i) {
+        if (i + 1 < ops.size() && !comp(ops[i].key, ops[i + 1].key)) {
+            continue;
+        }
+        if (kept != i) {
+            ops[kept] = std::move(ops[i]);
+        }
+        ++kept;
+    }
+    ops.erase(ops.begin() + kept, ops.end());
+
+    size_t total = this->size_ + tombstones_;
+    size_t depth = 1;
+    while ((size_t(1) << depth) <= total) {
+        ++depth;
+    }
+    if (ops.size() * depth < total) {
+        for (size_t i = 0; i < ops.size(); ++i) {
+            if (ops[i].remove) {
+                this->remove(ops[i].key);
+            }
+            else {
+                insert(std::make_pair(ops[i].key, ops[i].value));
+            }
+        }
+        return;
+    }
+
+    std::vector<AVLNode<Key, Value>*> nodes;
+    nodes.reserve(this->size_);
+    collectNodes(nodes, true);
+    tombstones_ = 0;
+
+    std::vector<AVLNode<Key, Value>*> merged;
+    merged.reserve(nodes.size() + ops.size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < nodes.size() || j < ops.size()) {
+        if (j == ops.size() || (i < nodes.size() && comp(nodes[i]->getKey(), ops[j].key))) {
+            merged.push_back(nodes[i++]);
+        }
+        else if (i == nodes.size() || comp(ops[j].key, nodes[i]->getKey())) {
+            if (!ops[j].remove) {
+                merged.push_back(createNode(ops[j].key, ops[j].value, NULL));
+                ++this->size_;
+            }
+            ++j;
+        }
+        else {
+            if (ops[j].remove) {
+                this->forgetNode(nodes[i]);
+                delete nodes[i];
+                --this->size_;
+            }
+            else {
+                nodes[i]->setValue(ops[j].value);
+                merged.push_back(nodes[i]);
+            }
+            ++i;
+            ++j;
+        }
+    }
+    rebuild(merged);
+}
+
+/**
+* Turns lazy removal on or off. Tombstones are purged once they exceed
+* maxTombstoneFraction of all nodes in the tree (live or not).
+* Turning it off purges any tombstones left behind.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::setLazyRemove(bool enabled, double maxTombstoneFraction)
+{
+    lazyRemove_ = enabled;
+    maxTombstoneFraction_ = maxTombstoneFraction;
+    if (!enabled && tombstones_ > 0) {
+        compact();
+    }
+}
+
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::getLazyRemove() const
+{
+    return lazyRemove_;
+}
+
+/**
+* Returns how many lazily removed nodes are still linked into the tree.
+*/
+template<class Key, class Value, class Compare>
+size_t AVLTree<Key, Value, Compare>::getTombstoneCount() const
+{
+    return tombstones_;
+}
+
+template<class Key, class Value, class Compare>
+size_t AVLTree<Key, Value, Compare>::nodeBytes() const
+{
+    return sizeof(AVLNode<Key, Value>);
+}
+
+/**
+* Tombstones still hold their node, so they count toward memory_usage.
+*/
+template<class Key, class Value, class Compare>
+size_t AVLTree<Key, Value, Compare>::linkedNodes() const
+{
+    return this->size_ + tombstones_;
+}
+
+/**
+* Frees every tombstone and relinks the live nodes into a perfectly
+* balanced tree. Runs in O(n) and allocates nothing but the node list.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::compact()
+{
+    if (tombstones_ == 0) {
+        return;
+    }
+    std::vector<AVLNode<Key, Value>*> nodes;
+    nodes.reserve(this->size_);
+    collectNodes(nodes, true);
+    tombstones_ = 0;
+    rebuild(nodes);
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::clear()
+{
+    BinarySearchTree<Key, Value, Compare>::clear();
+    tombstones_ = 0;
+}
+
+/**
+* Appends the tree's nodes to nodes in key order, deleting
+* tombstones along the way if purgeTombstones is set. The
+* tree's links are left dangling; callers rebuild it.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::collectNodes(std::vector<AVLNode<Key, Value>*>& nodes, bool purgeTombstones)
+{
+    std::vector<AVLNode<Key, Value>*> stack;
+    AVLNode<Key, Value>* curr = static_cast<AVLNode<Key, Value>*>(this->root_);
+    while (curr != NULL || !stack.empty()) {
+        while (curr != NULL) {
+            stack.push_back(curr);
+            curr = curr->getLeft();
+        }
+        curr = stack.back();
+        stack.pop_back();
+        AVLNode<Key, Value>* right = curr->getRight();
+        if (purgeTombstones && curr->isTombstone()) {
+            this->forgetNode(curr);
+            delete curr;
+        }
+        else {
+            nodes.push_back(curr);
+        }
+        curr = right;
+    }
+    this->root_ = NULL;
+    this->leftmost_ = NULL;
+    this->rightmost_ = NULL;
+}
+
+/**
+* Links nodes[lo, hi) into a perfectly balanced subtree under parent
+* and returns its root; height receives the subtree's height.
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::buildBalanced(std::vector<AVLNode<Key, Value>*>& nodes,
+    size_t lo, size_t hi, AVLNode<Key, Value>* parent, int& height)
+{
+    if (lo >= hi) {
+        height = 0;
+        return NULL;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    AVLNode<Key, Value>* root = nodes[mid];
+    int leftHeight;
+    int rightHeight;
+    root->setParent(parent);
+    root->setLeft(buildBalanced(nodes, lo, mid, root, leftHeight));
+    root->setRight(buildBalanced(nodes, mid + 1, hi, root, rightHeight));
+    root->setBalance(rightHeight - leftHeight);
+    if (augmented_) {
+        updateNode(root);
+    }
+    height = 1 + std::max(leftHeight, rightHeight);
+    return root;
+}
+
+/**
+* Replaces the tree's structure with a balanced tree over nodes,
+* which must be in key order.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::rebuild(std::vector<AVLNode<Key, Value>*>& nodes)
+{
+    int height;
+    this->root_ = buildBalanced(nodes, 0, nodes.size(), NULL, height);
+    this->leftmost_ = nodes.empty() ? NULL : nodes.front();
+    this->rightmost_ = nodes.empty() ? NULL : nodes.back();
+}
+
+/**
+* The stored balance must match the subtree heights and stay within 1.
+*/
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::checkNode(const Node<Key, Value>* n, int leftHeight, int rightHeight) const
+{
+    int balance = static_cast<const AVLNode<Key, Value>*>(n)->getBalance();
+    return balance == rightHeight - leftHeight && balance >= -1 && balance <= 1;
 }
 
 
-#endif
\ No newline at end of file
+#endif
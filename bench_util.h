@@ -0,0 +1,229 @@
+
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <string>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+// Small helpers shared by the benchmark drivers.  Nothing in here is
+// needed by the trees themselves.
+
+/**
+ * Wall-clock stopwatch started on construction.
+ */
+class BenchTimer
+{
+public:
+    BenchTimer() : start_(std::chrono::steady_clock::now()) { }
+
+    void reset()
+    {
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    double seconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * Keeps the compiler from discarding a value that is only computed
+ * for its timing.
+ */
+template<typename T>
+inline void doNotOptimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * Millions of operations per second.
+ */
+inline double mops(size_t ops, double seconds)
+{
+    return seconds > 0 ? ops / seconds / 1e6 : 0.0;
+}
+
+/**
+ * Reads argv[index] as a count, or returns fallback if it is missing.
+ */
+inline size_t argCount(int argc, char* argv[], int index, size_t fallback)
+{
+    if(argc > index) {
+        return std::strtoull(argv[index], NULL, 10);
+    }
+    return fallback;
+}
+
+/**
+ * Nanoseconds on the steady clock, for timing single operations.
+ */
+inline uint64_t nowNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Returns the p-th percentile (0-100) of samples, sorting them in place.
+ */
+inline uint64_t percentile(std::vector<uint64_t>& samples, double p)
+{
+    if(samples.empty()) {
+        return 0;
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t index = size_t(p / 100.0 * (samples.size() - 1) + 0.5);
+    return samples[index < samples.size() ? index : samples.size() - 1];
+}
+
+/**
+ * Counts of latencies in nanoseconds with bounded relative error, in the
+ * style of an HDR histogram: values below 256 get a bucket each, and each
+ * power of two above that is split into 128 buckets, so a recorded value
+ * is off by less than 1% at any magnitude. Recording is an index
+ * computation and an increment; the whole range up to 2^64 ns takes
+ * under 60 KB.
+ */
+class LatencyHistogram
+{
+public:
+    static const unsigned SUB_BITS = 7;
+    static const uint64_t SUB = uint64_t(1) << SUB_BITS;
+
+    LatencyHistogram() : counts_((64 - SUB_BITS + 1) * SUB, 0), total_(0), max_(0) { }
+
+    void record(uint64_t nanos)
+    {
+        ++counts_[bucketOf(nanos)];
+        ++total_;
+        max_ = std::max(max_, nanos);
+    }
+
+    void reset()
+    {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = 0;
+        max_ = 0;
+    }
+
+    uint64_t count() const
+    {
+        return total_;
+    }
+
+    uint64_t max() const
+    {
+        return max_;
+    }
+
+    /**
+     * Returns the largest value in the bucket holding the p-th percentile
+     * (0-100), capped at the recorded maximum.
+     */
+    uint64_t valueAtPercentile(double p) const
+    {
+        if(total_ == 0) {
+            return 0;
+        }
+        uint64_t rank = uint64_t(std::ceil(p / 100.0 * total_));
+        rank = std::max<uint64_t>(rank, 1);
+        uint64_t seen = 0;
+        for(size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if(seen >= rank) {
+                return std::min(highestInBucket(i), max_);
+            }
+        }
+        return max_;
+    }
+
+private:
+    static size_t bucketOf(uint64_t v)
+    {
+        if(v < 2 * SUB) {
+            return size_t(v);
+        }
+        unsigned msb = 63 - unsigned(__builtin_clzll(v));
+        unsigned shift = msb - SUB_BITS;
+        return size_t((shift + 1) * SUB + ((v >> shift) - SUB));
+    }
+
+    static uint64_t highestInBucket(size_t i)
+    {
+        if(i < 2 * SUB) {
+            return i;
+        }
+        unsigned shift = unsigned(i / SUB) - 1;
+        uint64_t top = SUB + i % SUB;
+        return ((top + 1) << shift) - 1;
+    }
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_;
+    uint64_t max_;
+};
+
+/**
+ * Draws ranks 0..n-1 with P(rank k) proportional to 1/(k+1)^skew,
+ * so rank 0 is the hottest.  Uses a precomputed CDF.
+ */
+class ZipfGenerator
+{
+public:
+    ZipfGenerator(size_t n, double skew, uint64_t seed) :
+        cdf_(n), rng_(seed), uniform_(0.0, 1.0)
+    {
+        double sum = 0;
+        for(size_t k = 0; k < n; ++k) {
+            sum += 1.0 / std::pow(double(k + 1), skew);
+            cdf_[k] = sum;
+        }
+        for(size_t k = 0; k < n; ++k) {
+            cdf_[k] /= sum;
+        }
+    }
+
+    size_t next()
+    {
+        double u = uniform_(rng_);
+        size_t k = std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin();
+        return k < cdf_.size() ? k : cdf_.size() - 1;
+    }
+
+private:
+    std::vector<double> cdf_;
+    std::mt19937_64 rng_;
+    std::uniform_real_distribution<double> uniform_;
+};
+
+/**
+ * Builds a trace of ops keys drawn from keys[] with Zipf-distributed
+ * popularity; the popularity order is a random permutation of keys.
+ */
+template<typename Key>
+std::vector<Key> zipfTrace(const std::vector<Key>& keys, size_t ops, double skew, uint64_t seed)
+{
+    std::vector<Key> byRank(keys);
+    std::mt19937_64 rng(seed);
+    std::shuffle(byRank.begin(), byRank.end(), rng);
+    ZipfGenerator zipf(keys.size(), skew, seed + 1);
+    std::vector<Key> trace(ops);
+    for(size_t i = 0; i < ops; ++i) {
+        trace[i] = byRank[zipf.next()];
+    }
+    return trace;
+}
+
+#endif
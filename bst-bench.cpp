@@ -0,0 +1,1233 @@
+#include <iostream>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <queue>
+#include <set>
+#include <random>
+#include <algorithm>
+#include "bst.h"
+#include "avlbst.h"
+#include "rbbst.h"
+#include "splaybst.h"
+#include "bufferedbst.h"
+#include "aggregatebst.h"
+#include "intervalbst.h"
+#include "lrubst.h"
+#include "densebst.h"
+#include "tracebst.h"
+#include "memory_usage.h"
+#include "bench_util.h"
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+// Benchmark driver for the search trees.
+// usage: bst-bench [benchmark [n]]   (no arguments runs every benchmark)
+
+// Plain operator< ordering, which keeps the trees from using cached
+// key prefixes or single-pass string comparisons.
+struct PlainStringLess
+{
+    bool operator()(const string& lhs, const string& rhs) const
+    {
+        return lhs < rhs;
+    }
+};
+
+static vector<string> makeUrlKeys(size_t n, mt19937_64& rng)
+{
+    static const char* const sections[] = { "users", "orders", "products", "sessions" };
+    vector<string> keys;
+    keys.reserve(n);
+    char buf[128];
+    for(size_t i = 0; i < n; ++i) {
+        snprintf(buf, sizeof(buf), "https://www.example.com/api/v2/%s/%08llu/detail?rev=%u",
+                 sections[rng() % 4], (unsigned long long)(rng() % 100000000ULL), (unsigned)(rng() % 1000));
+        keys.push_back(buf);
+    }
+    return keys;
+}
+
+static vector<string> makeUuidKeys(size_t n, mt19937_64& rng)
+{
+    vector<string> keys;
+    keys.reserve(n);
+    char buf[40];
+    for(size_t i = 0; i < n; ++i) {
+        uint64_t hi = rng();
+        uint64_t lo = rng();
+        snprintf(buf, sizeof(buf), "%08x-%04x-4%03x-%04x-%012llx",
+                 (unsigned)(hi >> 32), (unsigned)(hi >> 16) & 0xffff, (unsigned)hi & 0xfff,
+                 (unsigned)(lo >> 48), (unsigned long long)(lo & 0xffffffffffffULL));
+        keys.push_back(buf);
+    }
+    return keys;
+}
+
+template<typename Tree>
+static void timeStringTree(const char* name, const vector<string>& keys, const vector<string>& probes)
+{
+    Tree tree;
+    BenchTimer timer;
+    for(size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], (int)i));
+    }
+    double insertSecs = timer.seconds();
+
+    timer.reset();
+    size_t hits = 0;
+    for(size_t i = 0; i < probes.size(); ++i) {
+        hits += tree.find(probes[i]) != tree.end();
+    }
+    double findSecs = timer.seconds();
+    doNotOptimize(hits);
+
+    printf("  %-34s insert %7.2f Mops/s   find %7.2f Mops/s\n",
+           name, mops(keys.size(), insertSecs), mops(probes.size(), findSecs));
+}
+
+template<typename Map>
+static void timeStdMap(const char* name, const vector<string>& keys, const vector<string>& probes)
+{
+    Map tree;
+    BenchTimer timer;
+    for(size_t i = 0; i < keys.size(); ++i) {
+        tree[keys[i]] = (int)i;
+    }
+    double insertSecs = timer.seconds();
+
+    timer.reset();
+    size_t hits = 0;
+    for(size_t i = 0; i < probes.size(); ++i) {
+        hits += tree.find(probes[i]) != tree.end();
+    }
+    double findSecs = timer.seconds();
+    doNotOptimize(hits);
+
+    printf("  %-34s insert %7.2f Mops/s   find %7.2f Mops/s\n",
+           name, mops(keys.size(), insertSecs), mops(probes.size(), findSecs));
+}
+
+// Single three-way comparisons plus cached key prefixes versus
+// operator< on URL-like (long shared prefix) and UUID (random) keys.
+static void benchStringKeys(size_t n)
+{
+    mt19937_64 rng(2024);
+    for(int kind = 0; kind < 2; ++kind) {
+        vector<string> keys = kind == 0 ? makeUrlKeys(n, rng) : makeUuidKeys(n, rng);
+        vector<string> probes(keys);
+        shuffle(probes.begin(), probes.end(), rng);
+
+        printf("%s keys, n=%zu\n", kind == 0 ? "URL" : "UUID", n);
+        timeStringTree<AVLTree<string, int> >("AVLTree (prefix, 3-way)", keys, probes);
+        timeStringTree<AVLTree<string, int, PlainStringLess> >("AVLTree (operator<)", keys, probes);
+        timeStringTree<BinarySearchTree<string, int> >("BinarySearchTree (prefix, 3-way)", keys, probes);
+        timeStringTree<BinarySearchTree<string, int, PlainStringLess> >("BinarySearchTree (operator<)", keys, probes);
+        timeStdMap<map<string, int> >("std::map", keys, probes);
+    }
+}
+
+// Keeps a fixed population of n keys while replacing them: every step
+// removes a random live key and inserts a fresh one.
+template<typename Tree>
+static void timeChurn(const char* name, size_t n, size_t steps)
+{
+    mt19937_64 rng(7);
+    vector<uint64_t> live(n);
+    Tree tree;
+    for(size_t i = 0; i < n; ++i) {
+        live[i] = rng();
+        tree.insert(std::make_pair(live[i], i));
+    }
+    size_t rotationsBefore = tree.getRotationCount();
+
+    BenchTimer timer;
+    for(size_t i = 0; i < steps; ++i) {
+        size_t slot = rng() % n;
+        tree.remove(live[slot]);
+        live[slot] = rng();
+        tree.insert(std::make_pair(live[slot], i));
+    }
+    double secs = timer.seconds();
+
+    double rotationsPerOp = double(tree.getRotationCount() - rotationsBefore) / (2.0 * steps);
+    printf("  %-12s %7.2f Mops/s   %5.3f rotations/op\n", name, mops(2 * steps, secs), rotationsPerOp);
+}
+
+// AVL versus Red-Black under a remove/insert churn.
+static void benchChurn(size_t n)
+{
+    size_t steps = n;
+    printf("n=%zu, %zu remove+insert pairs\n", n, steps);
+    timeChurn<AVLTree<uint64_t, size_t> >("AVLTree", n, steps);
+    timeChurn<RBTree<uint64_t, size_t> >("RBTree", n, steps);
+
+    mt19937_64 rng(7);
+    vector<uint64_t> live(n);
+    map<uint64_t, size_t> reference;
+    for(size_t i = 0; i < n; ++i) {
+        live[i] = rng();
+        reference[live[i]] = i;
+    }
+    BenchTimer timer;
+    for(size_t i = 0; i < steps; ++i) {
+        size_t slot = rng() % n;
+        reference.erase(live[slot]);
+        live[slot] = rng();
+        reference[live[slot]] = i;
+    }
+    printf("  %-12s %7.2f Mops/s\n", "std::map", mops(2 * steps, timer.seconds()));
+}
+
+template<typename Tree>
+static void timeZipfLookups(const char* name, Tree& tree, const vector<uint64_t>& trace)
+{
+    size_t rotationsBefore = tree.getRotationCount();
+    BenchTimer timer;
+    uint64_t sum = 0;
+    for(size_t i = 0; i < trace.size(); ++i) {
+        sum += tree.find(trace[i])->second;
+    }
+    double secs = timer.seconds();
+    doNotOptimize(sum);
+    printf("  %-26s %7.2f Mops/s   %5.3f rotations/lookup\n", name, mops(trace.size(), secs),
+           double(tree.getRotationCount() - rotationsBefore) / trace.size());
+}
+
+// AVLTree versus SplayTree variants on Zipf-distributed lookups.
+static void benchZipf(size_t n)
+{
+    mt19937_64 rng(11);
+    vector<uint64_t> keys(n);
+    for(size_t i = 0; i < n; ++i) {
+        keys[i] = rng();
+    }
+
+    AVLTree<uint64_t, uint64_t> avl;
+    SplayTree<uint64_t, uint64_t> splay;
+    for(size_t i = 0; i < n; ++i) {
+        avl.insert(std::make_pair(keys[i], i));
+        splay.insert(std::make_pair(keys[i], i));
+    }
+
+    static const double skews[] = { 0.8, 0.99, 1.2 };
+    for(size_t s = 0; s < sizeof(skews) / sizeof(skews[0]); ++s) {
+        vector<uint64_t> trace = zipfTrace(keys, n, skews[s], 100 + s);
+        printf("n=%zu, %zu lookups, skew %.2f\n", n, trace.size(), skews[s]);
+        timeZipfLookups("AVLTree", avl, trace);
+
+        splay.setSplayMode(SPLAY_FULL);
+        splay.setSplayPeriod(1);
+        timeZipfLookups("SplayTree full", splay, trace);
+        splay.setSplayMode(SPLAY_SEMI);
+        timeZipfLookups("SplayTree semi", splay, trace);
+        splay.setSplayMode(SPLAY_FULL);
+        splay.setSplayPeriod(8);
+        timeZipfLookups("SplayTree full, every 8th", splay, trace);
+        splay.setSplayMode(SPLAY_SEMI);
+        timeZipfLookups("SplayTree semi, every 8th", splay, trace);
+    }
+}
+
+// Removes half of an n-key AVLTree one key at a time, timing each call.
+static void timeRemoves(const char* name, size_t n, bool lazy, double fraction)
+{
+    mt19937_64 rng(5);
+    vector<uint64_t> keys(n);
+    AVLTree<uint64_t, uint64_t> tree;
+    tree.setLazyRemove(lazy, fraction);
+    for(size_t i = 0; i < n; ++i) {
+        keys[i] = rng();
+        tree.insert(std::make_pair(keys[i], i));
+    }
+    shuffle(keys.begin(), keys.end(), rng);
+
+    vector<uint64_t> latencies(n / 2);
+    BenchTimer timer;
+    for(size_t i = 0; i < n / 2; ++i) {
+        uint64_t start = nowNanos();
+        tree.remove(keys[i]);
+        latencies[i] = nowNanos() - start;
+    }
+    double secs = timer.seconds();
+
+    printf("  %-22s %7.2f Mops/s   p50 %6llu ns   p99 %6llu ns   p99.9 %8llu ns   max %10llu ns\n",
+           name, mops(n / 2, secs),
+           (unsigned long long)percentile(latencies, 50), (unsigned long long)percentile(latencies, 99),
+           (unsigned long long)percentile(latencies, 99.9), (unsigned long long)percentile(latencies, 100));
+}
+
+// Remove latency with eager removal versus lazy tombstones.
+static void benchLazyRemove(size_t n)
+{
+    printf("n=%zu, removing %zu keys\n", n, n / 2);
+    timeRemoves("eager", n, false, 0);
+    timeRemoves("lazy, purge at 25%", n, true, 0.25);
+    timeRemoves("lazy, purge at 50%", n, true, 0.5);
+}
+
+// Builds a batch of m ops against a tree holding keys[]: 40% overwrite
+// existing keys, 30% insert new keys and 30% remove existing keys.
+static vector<BatchOp<uint64_t, uint64_t> > makeBatch(const vector<uint64_t>& keys, size_t m, mt19937_64& rng)
+{
+    vector<BatchOp<uint64_t, uint64_t> > ops;
+    ops.reserve(m);
+    for(size_t i = 0; i < m; ++i) {
+        unsigned kind = rng() % 10;
+        if(kind < 4) {
+            ops.push_back(BatchOp<uint64_t, uint64_t>::upsert(keys[rng() % keys.size()], i));
+        }
+        else if(kind < 7) {
+            ops.push_back(BatchOp<uint64_t, uint64_t>::upsert(rng(), i));
+        }
+        else {
+            ops.push_back(BatchOp<uint64_t, uint64_t>::erase(keys[rng() % keys.size()]));
+        }
+    }
+    return ops;
+}
+
+// apply_batch versus looping insert/remove, for batch sizes 100 to 1M
+// against a tree of n keys.
+static void benchBatch(size_t n)
+{
+    mt19937_64 rng(13);
+    vector<uint64_t> keys(n);
+    for(size_t i = 0; i < n; ++i) {
+        keys[i] = rng();
+    }
+    printf("tree of n=%zu keys\n", n);
+
+    for(size_t m = 100; m <= 1000000; m *= 10) {
+        vector<BatchOp<uint64_t, uint64_t> > ops = makeBatch(keys, m, rng);
+
+        AVLTree<uint64_t, uint64_t> looped;
+        AVLTree<uint64_t, uint64_t> batched;
+        for(size_t i = 0; i < n; ++i) {
+            looped.insert(std::make_pair(keys[i], i));
+            batched.insert(std::make_pair(keys[i], i));
+        }
+
+        BenchTimer timer;
+        for(size_t i = 0; i < ops.size(); ++i) {
+            if(ops[i].remove) {
+                looped.remove(ops[i].key);
+            }
+            else {
+                looped.insert(std::make_pair(ops[i].key, ops[i].value));
+            }
+        }
+        double loopSecs = timer.seconds();
+
+        timer.reset();
+        batched.apply_batch(std::move(ops));
+        double batchSecs = timer.seconds();
+
+        printf("  batch %8zu   per-op loop %7.2f Mops/s   apply_batch %7.2f Mops/s   (%s)\n",
+               m, mops(m, loopSecs), mops(m, batchSecs),
+               looped.size() == batched.size() ? "same size" : "SIZE MISMATCH");
+    }
+}
+
+// Times n random inserts followed by n random lookups (half of them
+// misses) against the same structure, without flushing in between.
+template<typename Tree>
+static void timeInsertsThenReads(const char* name, Tree& tree, const vector<uint64_t>& keys,
+                                 const vector<uint64_t>& probes)
+{
+    BenchTimer timer;
+    for(size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], i));
+    }
+    double insertSecs = timer.seconds();
+
+    timer.reset();
+    size_t hits = 0;
+    for(size_t i = 0; i < probes.size(); ++i) {
+        hits += tree.find(probes[i]) != tree.end();
+    }
+    double readSecs = timer.seconds();
+    doNotOptimize(hits);
+
+    printf("  %-22s insert %7.2f Mops/s   find %7.2f Mops/s\n",
+           name, mops(keys.size(), insertSecs), mops(probes.size(), readSecs));
+}
+
+// Sustained random-insert throughput of a plain AVLTree against the
+// same tree behind write buffers of several sizes, and what the buffer
+// costs lookups.
+static void benchWriteBuffer(size_t n)
+{
+    mt19937_64 rng(17);
+    vector<uint64_t> keys(n);
+    for(size_t i = 0; i < n; ++i) {
+        keys[i] = rng();
+    }
+    vector<uint64_t> probes(n);
+    for(size_t i = 0; i < n; ++i) {
+        probes[i] = (i % 2) ? keys[rng() % n] : rng();
+    }
+    printf("n=%zu random keys\n", n);
+
+    {
+        AVLTree<uint64_t, uint64_t> tree;
+        timeInsertsThenReads("AVLTree", tree, keys, probes);
+    }
+    for(size_t b = 64; b <= 65536; b *= 16) {
+        char name[64];
+        snprintf(name, sizeof(name), "buffered (B=%zu)", b);
+        BufferedAVLTree<uint64_t, uint64_t> tree(b);
+        timeInsertsThenReads(name, tree, keys, probes);
+    }
+}
+
+// Moves every other key of an n-key "active" tree into an "expired"
+// tree: remove plus insert (a free and an allocation per key) against
+// extract plus insert of the node handle, and against one merge.
+static void benchNodeHandle(size_t n)
+{
+    mt19937_64 rng(19);
+    vector<uint64_t> keys(n);
+    for(size_t i = 0; i < n; ++i) {
+        keys[i] = rng();
+    }
+    vector<uint64_t> moved;
+    for(size_t i = 0; i < n; i += 2) {
+        moved.push_back(keys[i]);
+    }
+    printf("moving %zu of n=%zu keys\n", moved.size(), n);
+
+    {
+        AVLTree<uint64_t, uint64_t> active;
+        AVLTree<uint64_t, uint64_t> expired;
+        for(size_t i = 0; i < n; ++i) {
+            active.insert(std::make_pair(keys[i], i));
+        }
+        BenchTimer timer;
+        for(size_t i = 0; i < moved.size(); ++i) {
+            uint64_t value = active[moved[i]];
+            active.remove(moved[i]);
+            expired.insert(std::make_pair(moved[i], value));
+        }
+        printf("  remove + insert        %7.2f Mops/s\n", mops(moved.size(), timer.seconds()));
+    }
+    {
+        AVLTree<uint64_t, uint64_t> active;
+        AVLTree<uint64_t, uint64_t> expired;
+        for(size_t i = 0; i < n; ++i) {
+            active.insert(std::make_pair(keys[i], i));
+        }
+        BenchTimer timer;
+        for(size_t i = 0; i < moved.size(); ++i) {
+            expired.insert(active.extract(moved[i]));
+        }
+        printf("  extract + insert       %7.2f Mops/s\n", mops(moved.size(), timer.seconds()));
+    }
+    {
+        AVLTree<uint64_t, uint64_t> active;
+        AVLTree<uint64_t, uint64_t> expired;
+        for(size_t i = 0; i < n; ++i) {
+            (i % 2 ? active : expired).insert(std::make_pair(keys[i], i));
+        }
+        BenchTimer timer;
+        expired.merge(active);
+        printf("  merge (%zu into %zu)   %7.2f Mops/s\n",
+               n - moved.size(), moved.size(), mops(n - moved.size(), timer.seconds()));
+    }
+}
+
+// Range sums over [lo, hi) covering 1%, 10% and 50% of the keys:
+// AggregateTree::aggregate against summing the values with an iterator
+// from lower_bound.
+static void benchAggregate(size_t n)
+{
+    mt19937_64 rng(23);
+    AggregateTree<uint64_t, uint64_t> tree;
+    for(size_t i = 0; i < n; ++i) {
+        tree.insert(std::make_pair(i * 2, rng() % 1000));
+    }
+    printf("n=%zu keys\n", n);
+
+    const double widths[] = { 0.01, 0.1, 0.5 };
+    for(size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w) {
+        uint64_t span = uint64_t(widths[w] * 2 * n);
+        size_t queries = 200;
+        vector<uint64_t> los(queries);
+        for(size_t q = 0; q < queries; ++q) {
+            los[q] = rng() % (2 * n - span);
+        }
+
+        BenchTimer timer;
+        uint64_t iterSum = 0;
+        for(size_t q = 0; q < queries; ++q) {
+            AggregateTree<uint64_t, uint64_t>::iterator it = tree.lower_bound(los[q]);
+            for(; it != tree.end() && it->first < los[q] + span; ++it) {
+                iterSum += it->second;
+            }
+        }
+        double iterSecs = timer.seconds();
+
+        timer.reset();
+        uint64_t aggSum = 0;
+        for(size_t q = 0; q < queries; ++q) {
+            aggSum += tree.aggregate(los[q], los[q] + span);
+        }
+        double aggSecs = timer.seconds();
+
+        printf("  range %4.0f%%   iterator %10.2f us/query   aggregate %7.2f us/query   (%s)\n",
+               widths[w] * 100, iterSecs * 1e6 / queries, aggSecs * 1e6 / queries,
+               iterSum == aggSum ? "same sums" : "SUM MISMATCH");
+    }
+}
+
+// Stabbing and overlap queries over n intervals with uniform starts and
+// exponentially distributed lengths (about 10 intervals per point):
+// IntervalTree against a linear scan of the same intervals.
+static void benchInterval(size_t n)
+{
+    typedef IntervalTree<uint64_t, uint32_t>::Interval Interval;
+    const uint64_t range = 1000 * n;
+    mt19937_64 rng(29);
+    exponential_distribution<double> length(1.0 / 10000);
+    vector<Interval> intervals(n);
+    vector<BatchOp<Interval, uint32_t> > ops;
+    ops.reserve(n);
+    for(size_t i = 0; i < n; ++i) {
+        uint64_t start = rng() % range;
+        intervals[i] = Interval(start, start + uint64_t(length(rng)));
+        ops.push_back(BatchOp<Interval, uint32_t>::upsert(intervals[i], uint32_t(i)));
+    }
+
+    BenchTimer timer;
+    IntervalTree<uint64_t, uint32_t> tree;
+    tree.apply_batch(std::move(ops));
+    printf("n=%zu intervals, built in %.2f s\n", n, timer.seconds());
+    ops.clear();
+    ops.shrink_to_fit();
+
+    const uint64_t widths[] = { 0, 100000 };
+    for(size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w) {
+        size_t treeQueries = 10000;
+        size_t scanQueries = 20;
+        vector<uint64_t> los(treeQueries);
+        for(size_t q = 0; q < treeQueries; ++q) {
+            los[q] = rng() % range;
+        }
+
+        timer.reset();
+        size_t treeHits = 0;
+        vector<IntervalTree<uint64_t, uint32_t>::iterator> out;
+        for(size_t q = 0; q < treeQueries; ++q) {
+            out.clear();
+            tree.findOverlapping(los[q], los[q] + widths[w], out);
+            treeHits += out.size();
+        }
+        double treeSecs = timer.seconds();
+
+        timer.reset();
+        size_t scanHits = 0;
+        size_t scanTreeHits = 0;
+        for(size_t q = 0; q < scanQueries; ++q) {
+            uint64_t lo = los[q];
+            uint64_t hi = lo + widths[w];
+            for(size_t i = 0; i < n; ++i) {
+                scanHits += intervals[i].first <= hi && intervals[i].second >= lo;
+            }
+        }
+        double scanSecs = timer.seconds();
+        for(size_t q = 0; q < scanQueries; ++q) {
+            out.clear();
+            tree.findOverlapping(los[q], los[q] + widths[w], out);
+            scanTreeHits += out.size();
+        }
+
+        printf("  %s   tree %8.2f us/query   scan %10.2f us/query   %.1f hits/query   (%s)\n",
+               widths[w] == 0 ? "stabbing       " : "overlap (w=1e5)",
+               treeSecs * 1e6 / treeQueries, scanSecs * 1e6 / scanQueries,
+               double(treeHits) / treeQueries, scanHits == scanTreeHits ? "same hits" : "HIT MISMATCH");
+    }
+}
+
+// Read-through OrderedLruCache over n keys, driven by Zipf traces of
+// 4n lookups: a miss inserts the key. Reports hit rate and throughput
+// for caches holding 1% and 10% of the keys.
+static void benchLru(size_t n)
+{
+    mt19937_64 rng(31);
+    vector<uint64_t> keys(n);
+    for(size_t i = 0; i < n; ++i) {
+        keys[i] = rng();
+    }
+    printf("n=%zu keys, %zu lookups per trace\n", n, 4 * n);
+
+    const double skews[] = { 0.8, 1.0, 1.2 };
+    for(size_t s = 0; s < sizeof(skews) / sizeof(skews[0]); ++s) {
+        vector<uint64_t> trace = zipfTrace(keys, 4 * n, skews[s], 37 + s);
+        for(size_t capacity = n / 100; capacity <= n / 10; capacity *= 10) {
+            OrderedLruCache<uint64_t, uint64_t> cache(capacity);
+            size_t hits = 0;
+            BenchTimer timer;
+            for(size_t i = 0; i < trace.size(); ++i) {
+                if(cache.find(trace[i]) != cache.end()) {
+                    ++hits;
+                }
+                else {
+                    cache.insert(std::make_pair(trace[i], i));
+                }
+            }
+            double secs = timer.seconds();
+            printf("  skew %.1f  capacity %7zu   hit rate %5.1f%%   %6.2f Mops/s   %zu evictions\n",
+                   skews[s], capacity, 100.0 * hits / trace.size(), mops(trace.size(), secs),
+                   cache.getEvictionCount());
+        }
+    }
+}
+
+// validate and shape_stats on an n-key AVLTree with 1, 2, 4, ... threads
+// up to twice the hardware thread count.
+static void benchValidate(size_t n)
+{
+    mt19937_64 rng(41);
+    vector<BatchOp<uint64_t, uint64_t> > ops;
+    ops.reserve(n);
+    for(size_t i = 0; i < n; ++i) {
+        ops.push_back(BatchOp<uint64_t, uint64_t>::upsert(rng(), i));
+    }
+    AVLTree<uint64_t, uint64_t> tree;
+    tree.apply_batch(std::move(ops));
+    ops.clear();
+    ops.shrink_to_fit();
+    printf("n=%zu keys, %u hardware threads\n", tree.size(), defaultThreadCount());
+
+    double base = 0;
+    for(unsigned threads = 1; threads <= 2 * defaultThreadCount(); threads *= 2) {
+        BenchTimer timer;
+        bool ok = tree.validate(NULL, threads);
+        double validateSecs = timer.seconds();
+        timer.reset();
+        ShapeStats stats = tree.shape_stats(threads);
+        double statsSecs = timer.seconds();
+        if(threads == 1) {
+            base = validateSecs;
+        }
+        printf("  %2u threads   validate %7.1f ms (%s, %.2fx)   shape_stats %7.1f ms   height %d, avg search depth %.2f\n",
+               threads, validateSecs * 1e3, ok ? "ok" : "INVALID", base / validateSecs,
+               statsSecs * 1e3, stats.height, stats.averageSearchDepth);
+    }
+}
+
+// Stream buffer that throws the output away and only counts it.
+class CountingBuf : public std::streambuf
+{
+public:
+    CountingBuf() : count_(0) { }
+    size_t count() const { return count_; }
+protected:
+    virtual int overflow(int c)
+    {
+        ++count_;
+        return c;
+    }
+    virtual std::streamsize xsputn(const char*, std::streamsize n)
+    {
+        count_ += n;
+        return n;
+    }
+private:
+    size_t count_;
+};
+
+// Full and top-level DOT/JSON exports of an n-key AVLTree.
+static void benchExport(size_t n)
+{
+    mt19937_64 rng(43);
+    AVLTree<uint64_t, uint64_t> tree;
+    for(size_t i = 0; i < n; ++i) {
+        tree.insert(std::make_pair(rng() % (10 * n), i));
+    }
+    printf("n=%zu keys\n", tree.size());
+
+    const int depths[] = { -1, 10 };
+    for(size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); ++d) {
+        for(int json = 0; json < 2; ++json) {
+            CountingBuf buf;
+            std::ostream out(&buf);
+            BenchTimer timer;
+            if(json) {
+                tree.exportJson(out, depths[d]);
+            }
+            else {
+                tree.exportDot(out, depths[d]);
+            }
+            double secs = timer.seconds();
+            printf("  %-4s %-9s %8.1f ms   %7.1f MB   %6.1f MB/s\n", json ? "JSON" : "DOT",
+                   depths[d] < 0 ? "full" : "10 levels", secs * 1e3, buf.count() / 1e6,
+                   secs > 0 ? buf.count() / 1e6 / secs : 0.0);
+        }
+    }
+}
+
+// Full scans of an n-key AVLTree built in random order, so that key
+// order and address order are unrelated: iterator loop vs for_each.
+static void benchForEach(size_t n)
+{
+    mt19937_64 rng(44);
+    AVLTree<uint64_t, uint64_t> tree;
+    for(size_t i = 0; i < n; ++i) {
+        tree.insert(std::make_pair(rng(), i));
+    }
+    printf("n=%zu keys, ~%.0f MB of nodes\n", tree.size(),
+           tree.size() * sizeof(AVLNode<uint64_t, uint64_t>) / 1e6);
+
+    for(int rep = 0; rep < 2; ++rep) {
+        uint64_t sum = 0;
+        BenchTimer timer;
+        for(AVLTree<uint64_t, uint64_t>::iterator it = tree.begin(); it != tree.end(); ++it) {
+            sum += it->second;
+        }
+        double iterSecs = timer.seconds();
+        doNotOptimize(sum);
+
+        sum = 0;
+        timer.reset();
+        tree.for_each([&sum](std::pair<const uint64_t, uint64_t>& item) { sum += item.second; });
+        double eachSecs = timer.seconds();
+        doNotOptimize(sum);
+
+        // middle tenth of the key space
+        uint64_t lo = UINT64_MAX / 20 * 9;
+        uint64_t hi = UINT64_MAX / 20 * 11;
+        size_t inRange = 0;
+        timer.reset();
+        for(AVLTree<uint64_t, uint64_t>::iterator it = tree.lower_bound(lo); it != tree.end() && it->first < hi; ++it) {
+            ++inRange;
+        }
+        double iterRangeSecs = timer.seconds();
+        timer.reset();
+        tree.for_each_range(lo, hi, [&inRange](std::pair<const uint64_t, uint64_t>&) { --inRange; });
+        double rangeSecs = timer.seconds();
+        doNotOptimize(inRange);
+
+        printf("  full scan   iterator %7.1f ms (%5.1f Mkeys/s)   for_each %7.1f ms (%5.1f Mkeys/s)   %.2fx\n",
+               iterSecs * 1e3, mops(tree.size(), iterSecs), eachSecs * 1e3, mops(tree.size(), eachSecs),
+               iterSecs / eachSecs);
+        printf("  10%% range   iterator %7.1f ms                     for_each_range %7.1f ms         %.2fx\n",
+               iterRangeSecs * 1e3, rangeSecs * 1e3, iterRangeSecs / rangeSecs);
+    }
+}
+
+// parallel_reduce (a floating-point sum) and parallel_for_each over an
+// n-key AVLTree at 1..max(4, hardware threads) threads, against a serial
+// for_each. The sums must match bit for bit at every thread count.
+static void benchParallel(size_t n)
+{
+    mt19937_64 rng(45);
+    AVLTree<uint64_t, double> tree;
+    for(size_t i = 0; i < n; ++i) {
+        tree.insert(std::make_pair(rng(), (rng() % 1000000) / 1000.0));
+    }
+    printf("n=%zu keys, %u hardware threads\n", tree.size(), defaultThreadCount());
+
+    double serial = 0;
+    BenchTimer timer;
+    tree.for_each([&serial](std::pair<const uint64_t, double>& item) { serial += item.second; });
+    double serialSecs = timer.seconds();
+    printf("  serial for_each     %7.1f ms   sum %.3f\n", serialSecs * 1e3, serial);
+
+    double first = 0;
+    double baseSecs = 0;
+    unsigned maxThreads = std::max(4u, defaultThreadCount());
+    for(unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        timer.reset();
+        double sum = tree.parallel_reduce(0.0,
+            [](std::pair<const uint64_t, double>& item) { return item.second; },
+            [](double a, double b) { return a + b; }, threads);
+        double reduceSecs = timer.seconds();
+        std::atomic<size_t> visited(0);
+        timer.reset();
+        tree.parallel_for_each([&visited](std::pair<const uint64_t, double>&) {
+            visited.fetch_add(1, std::memory_order_relaxed);
+        }, threads);
+        double eachSecs = timer.seconds();
+        if(threads == 1) {
+            first = sum;
+            baseSecs = reduceSecs;
+        }
+        printf("  %2u threads   parallel_reduce %7.1f ms (%.2fx)   parallel_for_each %7.1f ms   sum %s\n",
+               threads, reduceSecs * 1e3, baseSecs / reduceSecs, eachSecs * 1e3,
+               sum == first && visited == tree.size() ? "identical" : "DIFFERENT");
+    }
+}
+
+// Zipf lookups (find and operator[]) on an n-key AVLTree with and
+// without the hot-key cache, at a few cache sizes.
+static void benchHotCache(size_t n)
+{
+    mt19937_64 rng(46);
+    vector<uint64_t> keys(n);
+    AVLTree<uint64_t, uint64_t> tree;
+    for(size_t i = 0; i < n; ++i) {
+        keys[i] = rng();
+        tree.insert(std::make_pair(keys[i], i));
+    }
+
+    const size_t lookups = 5000000;
+    static const double skews[] = { 0.8, 1.0, 1.2 };
+    static const size_t slots[] = { 0, 1024, 4096, 16384 };
+    for(size_t s = 0; s < sizeof(skews) / sizeof(skews[0]); ++s) {
+        vector<uint64_t> trace = zipfTrace(keys, lookups, skews[s], 200 + s);
+        printf("n=%zu, %zu lookups, skew %.1f\n", n, trace.size(), skews[s]);
+        for(size_t c = 0; c < sizeof(slots) / sizeof(slots[0]); ++c) {
+            tree.setHotCache(slots[c]);
+            uint64_t sum = 0;
+            BenchTimer timer;
+            for(size_t i = 0; i < trace.size(); ++i) {
+                sum += (i & 1) ? tree[trace[i]] : tree.find(trace[i])->second;
+            }
+            double secs = timer.seconds();
+            doNotOptimize(sum);
+            size_t hits = tree.getHotCacheHits();
+            size_t total = hits + tree.getHotCacheMisses();
+            printf("  %5zu slots  %7.2f Mops/s   hit rate %5.1f%%\n", slots[c], mops(trace.size(), secs),
+                   total ? 100.0 * hits / total : 0.0);
+        }
+    }
+}
+
+// find, lower_bound and insert on local access traces over an n-key
+// AVLTree, from the root versus from a finger.
+static void benchFinger(size_t n)
+{
+    mt19937_64 rng(47);
+    vector<uint64_t> keys(n);
+    AVLTree<uint64_t, uint64_t> tree;
+    for(size_t i = 0; i < n; ++i) {
+        keys[i] = rng() & ~uint64_t(1);     // even, so odd keys are free to insert
+        tree.insert(std::make_pair(keys[i], i));
+    }
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+    const size_t ops = std::min<size_t>(1000000, keys.size());
+    // a sorted sample of the keys, and a window of 1024 ranks sliding up
+    // by one rank per lookup
+    vector<uint64_t> sorted(ops);
+    for(size_t i = 0; i < ops; ++i) {
+        sorted[i] = keys[i * (keys.size() / ops)];
+    }
+    vector<uint64_t> window(ops);
+    for(size_t i = 0; i < ops; ++i) {
+        size_t base = i * (keys.size() - 1024) / ops;
+        window[i] = keys[base + rng() % 1024];
+    }
+    printf("n=%zu keys, %zu ops per trace\n", tree.size(), ops);
+
+    const vector<uint64_t>* traces[] = { &sorted, &window };
+    const char* names[] = { "sorted batch", "sliding window" };
+    for(int t = 0; t < 2; ++t) {
+        const vector<uint64_t>& trace = *traces[t];
+        uint64_t sum = 0;
+        BenchTimer timer;
+        for(size_t i = 0; i < ops; ++i) {
+            sum += tree.find(trace[i])->second;
+        }
+        double rootSecs = timer.seconds();
+        AVLTree<uint64_t, uint64_t>::finger f;
+        timer.reset();
+        for(size_t i = 0; i < ops; ++i) {
+            sum += tree.find(f, trace[i])->second;
+        }
+        double fingerSecs = timer.seconds();
+        timer.reset();
+        for(size_t i = 0; i < ops; ++i) {
+            sum += (tree.lower_bound(trace[i] + 1) != tree.end());
+        }
+        double rootLbSecs = timer.seconds();
+        timer.reset();
+        for(size_t i = 0; i < ops; ++i) {
+            sum += (tree.lower_bound(f, trace[i] + 1) != tree.end());
+        }
+        double fingerLbSecs = timer.seconds();
+        doNotOptimize(sum);
+        printf("  %-15s find        root %6.2f Mops/s   finger %6.2f Mops/s   %.2fx\n", names[t],
+               mops(ops, rootSecs), mops(ops, fingerSecs), rootSecs / fingerSecs);
+        printf("  %-15s lower_bound root %6.2f Mops/s   finger %6.2f Mops/s   %.2fx\n", "",
+               mops(ops, rootLbSecs), mops(ops, fingerLbSecs), rootLbSecs / fingerLbSecs);
+    }
+
+    // sorted batch of new (odd) keys, inserted and then removed again
+    double insertSecs[2];
+    for(int useFinger = 0; useFinger < 2; ++useFinger) {
+        AVLTree<uint64_t, uint64_t>::finger f;
+        BenchTimer timer;
+        for(size_t i = 0; i < ops; ++i) {
+            if(useFinger) {
+                tree.insert(f, std::make_pair(sorted[i] + 1, i));
+            }
+            else {
+                tree.insert(std::make_pair(sorted[i] + 1, i));
+            }
+        }
+        insertSecs[useFinger] = timer.seconds();
+        for(size_t i = 0; i < ops; ++i) {
+            tree.remove(sorted[i] + 1);
+        }
+    }
+    printf("  %-15s insert      root %6.2f Mops/s   finger %6.2f Mops/s   %.2fx\n", "sorted batch",
+           mops(ops, insertSecs[0]), mops(ops, insertSecs[1]), insertSecs[0] / insertSecs[1]);
+}
+
+// n random inserts, finds, a full in-order walk and n random removes on
+// Map, returning the seconds spent in each phase.
+template<typename Map, typename K>
+static void timeSmallKeys(const vector<K>& trace, double secs[4])
+{
+    Map map;
+    BenchTimer timer;
+    for(size_t i = 0; i < trace.size(); ++i) {
+        map.insert(std::make_pair(trace[i], int(i)));
+    }
+    secs[0] = timer.seconds();
+    long sum = 0;
+    timer.reset();
+    for(size_t i = 0; i < trace.size(); ++i) {
+        sum += map.find(K(trace[i] ^ K(1))) != map.end();
+    }
+    secs[1] = timer.seconds();
+    timer.reset();
+    for(size_t r = 0; r < trace.size() / map.size(); ++r) {
+        for(typename Map::iterator it = map.begin(); it != map.end(); ++it) {
+            sum += it->second;
+        }
+    }
+    secs[2] = timer.seconds();
+    timer.reset();
+    for(size_t i = 0; i < trace.size(); ++i) {
+        map.remove(trace[i]);
+    }
+    secs[3] = timer.seconds();
+    doNotOptimize(sum);
+}
+
+template<typename K>
+static void benchSmallKeyType(const char* name, size_t n)
+{
+    mt19937_64 rng(46);
+    vector<K> trace(n);
+    for(size_t i = 0; i < n; ++i) {
+        trace[i] = K(rng());
+    }
+    double avl[4], dense[4];
+    timeSmallKeys<AVLTree<K, int> >(trace, avl);
+    timeSmallKeys<OrderedMap<K, int> >(trace, dense);
+    const char* phases[] = { "insert", "find", "iterate", "remove" };
+    for(int p = 0; p < 4; ++p) {
+        printf("  %-9s %-8s AVLTree %8.2f ms   DenseTable %8.2f ms   %6.1fx\n", p == 0 ? name : "", phases[p],
+               avl[p] * 1e3, dense[p] * 1e3, avl[p] / dense[p]);
+    }
+}
+
+// AVLTree versus the DenseTable that OrderedMap picks for char and
+// uint16_t keys; iterate walks the whole map about n / size times.
+static void benchSmallKeys(size_t n)
+{
+    printf("n=%zu ops per phase\n", n);
+    benchSmallKeyType<char>("char", n);
+    benchSmallKeyType<uint16_t>("uint16_t", n);
+}
+
+// A mixed insert/find/remove workload on an n-key AVLTree, plain, through
+// a RecordingTree that is not recording, and through one recording to a
+// trace file. The modes take turns, best of three runs each.
+static void benchTrace(size_t n)
+{
+    mt19937_64 rng(48);
+    vector<uint64_t> keys(n);
+    for(size_t i = 0; i < n; ++i) {
+        keys[i] = rng() % (2 * n);
+    }
+    const char* names[] = { "AVLTree", "not recording", "recording" };
+    double best[3] = { 0, 0, 0 };
+    uint64_t traceBytes = 0;
+    uint64_t traceOps = 0;
+    for(int run = 0; run < 3; ++run) {
+        // each mode goes first once: the first run after a tree is
+        // freed is consistently faster
+        for(int m = 0; m < 3; ++m) {
+            int mode = (m + run) % 3;
+            AVLTree<uint64_t, uint64_t> plain;
+            RecordingTree<uint64_t, uint64_t> recorded;
+            if(mode == 2) {
+                recorded.startRecording("bst-bench.trace");
+            }
+            uint64_t found = 0;
+            BenchTimer timer;
+            for(size_t i = 0; i < n; ++i) {
+                uint64_t k = keys[i];
+                if(mode == 0) {
+                    plain.insert(std::make_pair(k, k));
+                    found += plain.find(keys[i / 2]) != plain.end();
+                    if(i % 4 == 0) {
+                        plain.remove(keys[i / 3]);
+                    }
+                }
+                else {
+                    recorded.insert(std::make_pair(k, k));
+                    found += recorded.find(keys[i / 2]) != recorded.end();
+                    if(i % 4 == 0) {
+                        recorded.remove(keys[i / 3]);
+                    }
+                }
+            }
+            if(mode == 2) {
+                traceBytes = recorded.getRecorder()->bytes();
+                traceOps = recorded.getRecorder()->records();
+            }
+            recorded.stopRecording();
+            double secs = timer.seconds();
+            doNotOptimize(found);
+            if(run == 0 || secs < best[mode]) {
+                best[mode] = secs;
+            }
+        }
+    }
+    for(int mode = 0; mode < 3; ++mode) {
+        printf("  %-14s %8.1f ms  %+6.1f%%", names[mode], best[mode] * 1e3, (best[mode] / best[0] - 1) * 100);
+        if(mode == 2) {
+            printf("  %llu records, %.1f bytes each", (unsigned long long)traceOps, double(traceBytes) / traceOps);
+        }
+        printf("\n");
+    }
+    remove("bst-bench.trace");
+}
+
+// Bytes of heap in use according to the allocator, or 0 where that
+// cannot be asked.
+static size_t heapInUse()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+static void printUsage(const char* layout, size_t nodeSize, const MemoryUsage& usage, size_t measured)
+{
+    size_t n = usage.nodes ? usage.nodes : 1;
+    printf("  %-26s %5zu %7.1f %8.1f %7.1f %7.1f %9.1f", layout, nodeSize, double(usage.itemBytes) / n,
+           double(usage.nodeBytes - usage.itemBytes) / n, double(usage.heapBytes) / n,
+           double(usage.slackBytes + usage.otherBytes) / n, double(usage.total()) / n);
+    if(measured != 0) {
+        printf(" %9.1f", double(measured) / n);
+    }
+    printf("\n");
+}
+
+// Builds Tree from keys and reports memory_usage() per entry next to the
+// heap growth the allocator saw, which covers the node allocations only.
+template<typename Tree, typename K>
+static void reportLayout(const char* layout, size_t nodeSize, const vector<K>& keys)
+{
+    size_t before = heapInUse();
+    Tree* tree = new Tree;
+    for(size_t i = 0; i < keys.size(); ++i) {
+        tree->insert(std::make_pair(keys[i], int(i)));
+    }
+    size_t measured = heapInUse() - before;
+    printUsage(layout, nodeSize, tree->memory_usage(), measured);
+    delete tree;
+}
+
+// memory_usage() for each tree layout holding n int -> int entries (n
+// string keys of 32 bytes, and at most 2^16 uint16_t keys, for the last
+// rows). "measured" is the allocator's view of the same build.
+static void benchMemory(size_t n)
+{
+    mt19937_64 rng(49);
+    vector<int> keys(n);
+    for(size_t i = 0; i < n; ++i) {
+        keys[i] = int(rng());
+    }
+    printf("bytes per entry, n=%zu\n", n);
+    printf("  %-26s %5s %7s %8s %7s %7s %9s %9s\n", "layout", "node", "item", "overhead", "heap", "slack",
+           "total", "measured");
+    reportLayout<BinarySearchTree<int, int> >("BinarySearchTree (Node)", sizeof(Node<int, int>), keys);
+    reportLayout<AVLTree<int, int> >("AVLTree (AVLNode)", sizeof(AVLNode<int, int>), keys);
+    reportLayout<RBTree<int, int> >("RBTree (RBNode)", sizeof(RBNode<int, int>), keys);
+    reportLayout<SplayTree<int, int> >("SplayTree (Node)", sizeof(Node<int, int>), keys);
+    reportLayout<AggregateTree<int, int> >("AggregateTree (sum)", sizeof(AggregateNode<int, int>), keys);
+
+    vector<std::string> strings(n);
+    for(size_t i = 0; i < n; ++i) {
+        char buffer[33];
+        snprintf(buffer, sizeof(buffer), "%032llx", (unsigned long long)rng());
+        strings[i] = buffer;
+    }
+    reportLayout<AVLTree<std::string, int> >("AVLTree, 32-byte strings", sizeof(AVLNode<std::string, int>),
+                                              strings);
+
+    vector<uint16_t> small(std::min<size_t>(n, 65536));
+    for(size_t i = 0; i < small.size(); ++i) {
+        small[i] = uint16_t(i);
+    }
+    std::shuffle(small.begin(), small.end(), rng);
+    reportLayout<AVLTree<uint16_t, int> >("AVLTree, uint16_t keys", sizeof(AVLNode<uint16_t, int>), small);
+    reportLayout<DenseTable<uint16_t, int> >("DenseTable, uint16_t keys", sizeof(std::pair<const uint16_t, int>),
+                                             small);
+}
+
+// A timer queue holding n pending timers: each step fires the earliest
+// timer and schedules a new one up to 2n ticks after it. Keys pack the
+// deadline above a sequence number so that they are unique. Returns the
+// seconds taken by the steps for one queue implementation.
+static double timerSteps(int mode, size_t n, const vector<uint64_t>& delays)
+{
+    const size_t steps = delays.size() - n;
+    AVLTree<uint64_t, uint64_t> avl;
+    RBTree<uint64_t, uint64_t> rb;
+    std::priority_queue<uint64_t, vector<uint64_t>, std::greater<uint64_t> > heap;
+    std::set<uint64_t> ordered;
+    uint64_t seq = 0;
+    for(size_t i = 0; i < n; ++i) {
+        uint64_t key = (delays[i] << 24) | seq++;
+        if(mode <= 1) {
+            avl.insert(std::make_pair(key, key));
+        }
+        else if(mode == 2) {
+            rb.insert(std::make_pair(key, key));
+        }
+        else if(mode == 3) {
+            heap.push(key);
+        }
+        else {
+            ordered.insert(key);
+        }
+    }
+    uint64_t fired = 0;
+    BenchTimer timer;
+    for(size_t i = 0; i < steps; ++i) {
+        uint64_t first;
+        if(mode == 0) {
+            first = avl.pop_min().first;
+        }
+        else if(mode == 1) {
+            first = avl.begin()->first;
+            avl.remove(first);
+        }
+        else if(mode == 2) {
+            first = rb.pop_min().first;
+        }
+        else if(mode == 3) {
+            first = heap.top();
+            heap.pop();
+        }
+        else {
+            first = *ordered.begin();
+            ordered.erase(ordered.begin());
+        }
+        fired += first;
+        uint64_t key = (((first >> 24) + delays[n + i]) << 24) | (seq++ & 0xffffff);
+        if(mode <= 1) {
+            avl.insert(std::make_pair(key, key));
+        }
+        else if(mode == 2) {
+            rb.insert(std::make_pair(key, key));
+        }
+        else if(mode == 3) {
+            heap.push(key);
+        }
+        else {
+            ordered.insert(key);
+        }
+    }
+    double secs = timer.seconds();
+    doNotOptimize(fired);
+    return secs;
+}
+
+// Timer-queue workload (see timerSteps) on the trees' pop_min, on the
+// old begin() plus remove(key), and on the standard containers. The
+// implementations take turns, best of three runs each.
+static void benchTimers(size_t n)
+{
+    const size_t steps = 4 * n;
+    mt19937_64 rng(50);
+    vector<uint64_t> delays(n + steps);
+    for(size_t i = 0; i < delays.size(); ++i) {
+        delays[i] = rng() % (2 * n) + 1;
+    }
+    printf("n=%zu pending timers, %zu fire-and-reschedule steps\n", n, steps);
+    const char* names[] = { "AVLTree pop_min", "AVLTree begin+remove", "RBTree pop_min",
+        "std::priority_queue", "std::set" };
+    double best[5] = { 0, 0, 0, 0, 0 };
+    for(int run = 0; run < 3; ++run) {
+        for(int m = 0; m < 5; ++m) {
+            int mode = (m + run) % 5;
+            double secs = timerSteps(mode, n, delays);
+            if(run == 0 || secs < best[mode]) {
+                best[mode] = secs;
+            }
+        }
+    }
+    for(int mode = 0; mode < 5; ++mode) {
+        printf("  %-22s %8.1f ms  %6.2f Msteps/s\n", names[mode], best[mode] * 1e3, mops(steps, best[mode]));
+    }
+}
+
+struct Benchmark
+{
+    const char* name;
+    void (*run)(size_t n);
+    size_t defaultSize;
+};
+
+static const Benchmark benchmarks[] = {
+    { "string-keys", benchStringKeys, 500000 },
+    { "churn", benchChurn, 1000000 },
+    { "zipf", benchZipf, 1000000 },
+    { "lazy-remove", benchLazyRemove, 1000000 },
+    { "batch", benchBatch, 1000000 },
+    { "write-buffer", benchWriteBuffer, 1000000 },
+    { "node-handle", benchNodeHandle, 1000000 },
+    { "aggregate", benchAggregate, 1000000 },
+    { "interval", benchInterval, 10000000 },
+    { "lru", benchLru, 1000000 },
+    { "validate", benchValidate, 5000000 },
+    { "export", benchExport, 1000000 },
+    { "for-each", benchForEach, 10000000 },
+    { "parallel", benchParallel, 5000000 },
+    { "hot-cache", benchHotCache, 10000000 },
+    { "finger", benchFinger, 4000000 },
+    { "small-keys", benchSmallKeys, 10000000 },
+    { "trace", benchTrace, 1000000 },
+    { "memory", benchMemory, 1000000 },
+    { "timers", benchTimers, 100000 },
+};
+
+int main(int argc, char *argv[])
+{
+    bool ran = false;
+    for(size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); ++i) {
+        if(argc > 1 && strcmp(argv[1], benchmarks[i].name) != 0) {
+            continue;
+        }
+        cout << "== " << benchmarks[i].name << " ==" << endl;
+        benchmarks[i].run(argCount(argc, argv, 2, benchmarks[i].defaultSize));
+        ran = true;
+    }
+    if(!ran) {
+        cout << "usage: " << argv[0] << " [benchmark [n]]" << endl << "benchmarks:";
+        for(size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); ++i) {
+            cout << " " << benchmarks[i].name;
+        }
+        cout << endl;
+        return 1;
+    }
+    return 0;
+}
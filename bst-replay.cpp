@@ -0,0 +1,187 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "bst.h"
+#include "avlbst.h"
+#include "rbbst.h"
+#include "splaybst.h"
+#include "tracebst.h"
+#include "bench_util.h"
+
+using namespace std;
+
+// Replays a trace recorded by RecordingTree against one or all of the
+// tree backends and reports throughput and the trees' counters.
+// usage: bst-replay trace [bst|avl|rb|splay|all [paced]]
+//   By default operations run back to back; with "paced" each one waits
+//   for its recorded offset from the start of the trace. The trace is
+//   read into memory first, so file reads are not timed. Keys of up to
+//   8 bytes are supported; values are replayed as 8-byte payloads.
+
+struct ReplayOp
+{
+    TraceOp op;
+    uint64_t nanos;
+    uint64_t key;       // the key's bytes, copied to the front
+    uint64_t value;
+};
+
+struct ReplayResult
+{
+    double seconds;
+    uint64_t counts[TRACE_CLEAR + 1];
+    uint64_t hits;          // finds and lower_bounds that found a key
+    uint64_t maxLateNanos;  // paced only: worst delay past the recorded time
+};
+
+template<typename Key>
+static Key keyOf(const ReplayOp& op)
+{
+    Key key;
+    memcpy(&key, &op.key, sizeof(Key));
+    return key;
+}
+
+template<typename Key, typename Tree>
+static ReplayResult replay(Tree& tree, const vector<ReplayOp>& ops, bool paced)
+{
+    ReplayResult result;
+    memset(&result, 0, sizeof(result));
+    uint64_t start = nowNanos();
+    for(size_t i = 0; i < ops.size(); ++i) {
+        const ReplayOp& op = ops[i];
+        if(paced) {
+            uint64_t due = start + op.nanos;
+            uint64_t now = nowNanos();
+            while(now < due) {
+                now = nowNanos();
+            }
+            result.maxLateNanos = max(result.maxLateNanos, now - due);
+        }
+        ++result.counts[op.op];
+        switch(op.op) {
+        case TRACE_INSERT:
+            tree.insert(make_pair(keyOf<Key>(op), op.value));
+            break;
+        case TRACE_REMOVE:
+            tree.remove(keyOf<Key>(op));
+            break;
+        case TRACE_FIND:
+            result.hits += tree.find(keyOf<Key>(op)) != tree.end();
+            break;
+        case TRACE_LOWER_BOUND:
+            result.hits += tree.lower_bound(keyOf<Key>(op)) != tree.end();
+            break;
+        case TRACE_CLEAR:
+            tree.clear();
+            break;
+        }
+    }
+    result.seconds = (nowNanos() - start) / 1e9;
+    return result;
+}
+
+template<typename Key, typename Tree>
+static void runBackend(const char* name, const vector<ReplayOp>& ops, bool paced)
+{
+    Tree tree;
+    ReplayResult r = replay<Key>(tree, ops, paced);
+    printf("  %-6s %8.3f s  %7.2f Mops/s  %zu keys left, height %d, %zu rotations, %llu lookup hits",
+           name, r.seconds, mops(ops.size(), r.seconds), tree.size(), tree.shape_stats().height,
+           tree.getRotationCount(), (unsigned long long)r.hits);
+    if(paced) {
+        printf(", max %.1f us late", r.maxLateNanos / 1e3);
+    }
+    printf("\n");
+}
+
+template<typename Key>
+static bool runBackends(const string& backend, const vector<ReplayOp>& ops, bool paced)
+{
+    bool all = backend == "all";
+    bool ran = false;
+    if(all || backend == "bst") {
+        runBackend<Key, BinarySearchTree<Key, uint64_t> >("bst", ops, paced);
+        ran = true;
+    }
+    if(all || backend == "avl") {
+        runBackend<Key, AVLTree<Key, uint64_t> >("avl", ops, paced);
+        ran = true;
+    }
+    if(all || backend == "rb") {
+        runBackend<Key, RBTree<Key, uint64_t> >("rb", ops, paced);
+        ran = true;
+    }
+    if(all || backend == "splay") {
+        runBackend<Key, SplayTree<Key, uint64_t> >("splay", ops, paced);
+        ran = true;
+    }
+    return ran;
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2) {
+        cout << "usage: " << argv[0] << " trace [bst|avl|rb|splay|all [paced]]" << endl;
+        return 1;
+    }
+    string backend = argc > 2 ? argv[2] : "all";
+    bool paced = argc > 3 && strcmp(argv[3], "paced") == 0;
+
+    vector<ReplayOp> ops;
+    TraceHeader header;
+    try {
+        TraceReader reader(argv[1]);
+        header = reader.header();
+        if(header.keyBytes == 0 || header.keyBytes > 8 || (header.keyBytes & (header.keyBytes - 1)) != 0) {
+            cerr << argv[1] << ": " << int(header.keyBytes) << "-byte keys are not supported" << endl;
+            return 1;
+        }
+        TraceRecord record;
+        while(reader.next(record)) {
+            ReplayOp op = { record.op, record.nanos, 0, 0 };
+            memcpy(&op.key, record.key, header.keyBytes);
+            memcpy(&op.value, record.value, min<size_t>(header.valueBytes, sizeof(op.value)));
+            ops.push_back(op);
+        }
+    }
+    catch(const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    ReplayResult counts;
+    memset(&counts, 0, sizeof(counts));
+    for(size_t i = 0; i < ops.size(); ++i) {
+        ++counts.counts[ops[i].op];
+    }
+    printf("%zu ops over %.3f s recorded: %llu insert, %llu remove, %llu find, %llu lower_bound, %llu clear\n",
+           ops.size(), ops.empty() ? 0.0 : ops.back().nanos / 1e9,
+           (unsigned long long)counts.counts[TRACE_INSERT], (unsigned long long)counts.counts[TRACE_REMOVE],
+           (unsigned long long)counts.counts[TRACE_FIND], (unsigned long long)counts.counts[TRACE_LOWER_BOUND],
+           (unsigned long long)counts.counts[TRACE_CLEAR]);
+
+    bool ran = false;
+    switch(header.keyBytes) {
+    case 1:
+        ran = header.keySigned ? runBackends<int8_t>(backend, ops, paced) : runBackends<uint8_t>(backend, ops, paced);
+        break;
+    case 2:
+        ran = header.keySigned ? runBackends<int16_t>(backend, ops, paced) : runBackends<uint16_t>(backend, ops, paced);
+        break;
+    case 4:
+        ran = header.keySigned ? runBackends<int32_t>(backend, ops, paced) : runBackends<uint32_t>(backend, ops, paced);
+        break;
+    default:
+        ran = header.keySigned ? runBackends<int64_t>(backend, ops, paced) : runBackends<uint64_t>(backend, ops, paced);
+        break;
+    }
+    if(!ran) {
+        cerr << "unknown backend " << backend << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,10 +1,34 @@
 #include <iostream>
+#include <atomic>
 #include <map>
+#include <string>
+#include <string_view>
+#include <vector>
 #include "bst.h"
 #include "avlbst.h"
+#include "rbbst.h"
+#include "splaybst.h"
+#include "bufferedbst.h"
+#include "aggregatebst.h"
+#include "intervalbst.h"
+#include "multibst.h"
+#include "lrubst.h"
+#include "densebst.h"
+#include "tracebst.h"
 
 using namespace std;
 
+// Orders strings and string_views against each other so that lookups
+// never have to build a temporary std::string.
+struct TransparentStringLess
+{
+    typedef void is_transparent;
+    bool operator()(string_view lhs, string_view rhs) const
+    {
+        return lhs < rhs;
+    }
+};
+
 
 int main(int argc, char *argv[])
 {
@@ -44,5 +68,385 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     at.remove('b');
 
+    // Lazy removal tests
+    AVLTree<int,int> lt;
+    lt.setLazyRemove(true, 0.5);
+    for(int i = 1; i <= 6; ++i) {
+        lt.insert(std::make_pair(i, i * 10));
+    }
+    lt.remove(2);
+    lt.remove(5);
+    cout << "\nAVLTree with lazy removes: size " << lt.size()
+         << ", tombstones " << lt.getTombstoneCount() << endl;
+    for(AVLTree<int,int>::iterator it = lt.begin(); it != lt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "find(5) " << (lt.find(5) == lt.end() ? "missing" : "found") << endl;
+    lt.insert(std::make_pair(5, 55));
+    lt.remove(1);
+    lt.remove(3);
+    lt.remove(4);
+    cout << "After purge: size " << lt.size() << ", tombstones " << lt.getTombstoneCount() << endl;
+    for(AVLTree<int,int>::iterator it = lt.begin(); it != lt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // Batch update tests
+    AVLTree<int,int> bat;
+    for(int i = 0; i < 5; ++i) {
+        bat.insert(std::make_pair(i, i));
+    }
+    std::vector<BatchOp<int,int> > ops;
+    ops.push_back(BatchOp<int,int>::upsert(7, 70));
+    ops.push_back(BatchOp<int,int>::erase(1));
+    ops.push_back(BatchOp<int,int>::upsert(3, 30));
+    ops.push_back(BatchOp<int,int>::upsert(3, 33));
+    ops.push_back(BatchOp<int,int>::erase(9));
+    bat.apply_batch(std::move(ops));
+    cout << "\nAVLTree after batch: size " << bat.size() << endl;
+    for(AVLTree<int,int>::iterator it = bat.begin(); it != bat.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // Node handle tests
+    AVLTree<int,int> active;
+    AVLTree<int,int> expired;
+    for(int i = 0; i < 6; ++i) {
+        active.insert(std::make_pair(i, i * 10));
+    }
+    expired.insert(std::make_pair(5, -1));
+    AVLTree<int,int>::node_type nh = active.extract(2);
+    cout << "\nExtracted " << nh.key() << " " << nh.mapped() << ", active size " << active.size() << endl;
+    expired.insert(std::move(nh));
+    expired.merge(active);
+    cout << "After merge: active size " << active.size() << ", expired contents:" << endl;
+    for(AVLTree<int,int>::iterator it = expired.begin(); it != expired.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // Aggregate tests
+    AggregateTree<int,int> sums;
+    AggregateTree<int,int,MaxAggregate<int> > maxes;
+    for(int i = 1; i <= 10; ++i) {
+        sums.insert(std::make_pair(i, i));
+        maxes.insert(std::make_pair(i, (i * 7) % 11));
+    }
+    sums.remove(5);
+    sums.insert(std::make_pair(2, 20));
+    cout << "\nSum of all = " << sums.aggregate() << endl;
+    cout << "Sum over [2, 6) = " << sums.aggregate(2, 6) << endl;
+    cout << "Max over [1, 4) = " << maxes.aggregate(1, 4) << endl;
+    maxes.remove(2);
+    maxes.insert(sums.extract(2));
+    cout << "After moving 2 to the max tree: sum " << sums.aggregate() << ", max " << maxes.aggregate() << endl;
+    sums.update(sums.find(3), 30);
+    cout << "After updating 3 to 30: sum over [2, 6) = " << sums.aggregate(2, 6)
+         << ", valid " << sums.validate() << endl;
+
+    // Interval tree tests
+    IntervalTree<int,char> iv;
+    iv.insert(1, 5, 'a');
+    iv.insert(3, 9, 'b');
+    iv.insert(6, 7, 'c');
+    iv.insert(10, 12, 'd');
+    iv.insert(3, 4, 'e');
+    iv.remove(3, 4);
+    std::vector<IntervalTree<int,char>::iterator> hits;
+    iv.findStabbing(6, hits);
+    cout << "\nIntervals containing 6:";
+    for(size_t i = 0; i < hits.size(); ++i) {
+        cout << " " << hits[i]->second;
+    }
+    hits.clear();
+    iv.findOverlapping(5, 10, hits);
+    cout << endl << "Intervals overlapping [5, 10]:";
+    for(size_t i = 0; i < hits.size(); ++i) {
+        cout << " " << hits[i]->second;
+    }
+    cout << endl;
+    bool rejected = false;
+    try {
+        iv.insert(9, 2, 'x');
+    }
+    catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    cout << "Backwards interval rejected " << rejected << ", size " << iv.size()
+         << ", valid " << iv.validate() << endl;
+
+    // Multimap tests
+    AVLMultiMap<string,int> mm;
+    mm.insert(std::make_pair(string("b"), 1));
+    mm.insert(std::make_pair(string("a"), 2));
+    mm.insert(std::make_pair(string("b"), 3));
+    mm.insert(std::make_pair(string("b"), 4));
+    mm.removeOne("b");
+    cout << "\nMultimap: size " << mm.size() << ", keys " << mm.keyCount()
+         << ", count(b) = " << mm.count("b") << endl;
+    std::pair<AVLMultiMap<string,int>::iterator, AVLMultiMap<string,int>::iterator> range = mm.equal_range("b");
+    for(AVLMultiMap<string,int>::iterator it = range.first; it != range.second; ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // LRU cache tests
+    OrderedLruCache<int,string> lru(3);
+    lru.insert(std::make_pair(30, string("c")));
+    lru.insert(std::make_pair(10, string("a")));
+    lru.insert(std::make_pair(20, string("b")));
+    lru.find(30);
+    lru.insert(std::make_pair(40, string("d")));
+    cout << "\nLRU cache after evicting " << lru.getEvictionCount() << ", next out " << lru.leastRecentKey() << ":" << endl;
+    for(OrderedLruCache<int,string>::iterator it = lru.begin(); it != lru.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // Validation and shape tests
+    AVLTree<int,int> shaped;
+    for(int i = 0; i < 100; ++i) {
+        shaped.insert(std::make_pair(i, i));
+    }
+    ShapeStats stats = shaped.shape_stats(4);
+    cout << "\nAVLTree of 100: valid " << shaped.validate(NULL, 4) << ", height " << stats.height
+         << ", average search depth " << stats.averageSearchDepth << endl;
+    cout << "Depth histogram:";
+    for(size_t d = 0; d < stats.depthHistogram.size(); ++d) {
+        cout << " " << stats.depthHistogram[d];
+    }
+    cout << endl;
+
+    // Export tests
+    cout << "\nJSON export, 2 levels:" << endl;
+    shaped.exportJson(cout, 2);
+    AVLTree<char,int> small;
+    for(char c = 'a'; c <= 'c'; ++c) {
+        small.insert(std::make_pair(c, c - 'a'));
+    }
+    cout << "DOT export:" << endl;
+    small.exportDot(cout);
+
+    // Internal iteration tests
+    long sum = 0;
+    shaped.for_each([&sum](std::pair<const int,int>& item) { sum += item.second; });
+    cout << "\nfor_each sum: " << sum << endl;
+    cout << "for_each_range [10, 15):";
+    shaped.for_each_range(10, 15, [](std::pair<const int,int>& item) { cout << " " << item.first; });
+    cout << endl;
+    int firstOver = -1;
+    bool all = shaped.visit([&firstOver](std::pair<const int,int>& item) {
+        firstOver = item.first;
+        return item.second * item.second <= 50;
+    });
+    cout << "visit stopped at " << firstOver << ", visited all " << all << endl;
+
+    // Parallel iteration tests
+    std::atomic<long> parallelSum(0);
+    shaped.parallel_for_each([&parallelSum](std::pair<const int,int>& item) { parallelSum += item.second; }, 4);
+    std::string digits = shaped.parallel_reduce_range(20, 30, std::string(),
+        [](std::pair<const int,int>& item) { return std::to_string(item.first % 10); },
+        [](const std::string& a, const std::string& b) { return a + b; }, 4);
+    cout << "parallel_for_each sum: " << parallelSum << ", parallel_reduce_range [20, 30) concatenated: "
+         << digits << endl;
+
+    // Hot-key cache tests
+    AVLTree<int,int> hot;
+    hot.setHotCache(8);
+    for(int i = 0; i < 10; ++i) {
+        hot.insert(std::make_pair(i, i * i));
+    }
+    for(int round = 0; round < 3; ++round) {
+        hot.find(3);
+        hot[7];
+    }
+    hot.remove(3);
+    cout << "\nHot cache: " << hot.getHotCacheSize() << " slots, find(3) after remove: "
+         << (hot.find(3) == hot.end() ? "end" : "found") << ", hits " << hot.getHotCacheHits()
+         << ", misses " << hot.getHotCacheMisses() << endl;
+
+    // Finger search tests
+    AVLTree<int,int> fingered;
+    AVLTree<int,int>::finger cursor;
+    for(int i = 0; i < 20; i += 2) {
+        fingered.insert(cursor, std::make_pair(i, i));
+    }
+    cout << "\nFinger find(6): " << fingered.find(cursor, 6)->second << ", lower_bound(7): "
+         << fingered.lower_bound(cursor, 7)->first << ", find(5) at end: "
+         << (fingered.find(cursor, 5) == fingered.end()) << endl;
+    AVLTree<int,int> drained;
+    fingered.find(cursor, 12);
+    drained.merge(hot);
+    drained.merge(fingered);
+    cout << "After merging both away: hot find(7) " << (hot.find(7) == hot.end() ? "end" : "found")
+         << ", finger find(10) " << (fingered.find(cursor, 10) == fingered.end() ? "end" : "found") << endl;
+
+    // Dense table tests
+    OrderedMap<char,int> dense;
+    static_assert(std::is_same<OrderedMap<char,int>, DenseTable<char,int> >::value, "char keys use a DenseTable");
+    static_assert(std::is_same<OrderedMap<int,int>, AVLTree<int,int> >::value, "int keys use an AVLTree");
+    dense.insert(std::make_pair('c', 3));
+    dense.insert(std::make_pair('a', 1));
+    dense.insert(std::make_pair(char(-5), -5));
+    dense.insert(std::make_pair('b', 2));
+    dense.insert(std::make_pair('c', 30));
+    dense.remove('a');
+    cout << "\nDense table:";
+    for(OrderedMap<char,int>::iterator it = dense.begin(); it != dense.end(); ++it) {
+        cout << " " << int(it->first) << "=" << it->second;
+    }
+    cout << ", size " << dense.size() << ", lower_bound('a'): " << dense.lower_bound('a')->first
+         << ", find('a') at end: " << (dense.find('a') == dense.end()) << endl;
+
+    // Trace recording tests
+    RecordingTree<int,int> recorded;
+    recorded.insert(std::make_pair(1, 10));
+    recorded.startRecording("bst-test.trace");
+    recorded.insert(std::make_pair(2, 20));
+    recorded.insert(std::make_pair(3, 30));
+    recorded.find(2);
+    recorded.remove(1);
+    recorded.lower_bound(0);
+    std::vector<BatchOp<int,int> > recordedOps;
+    recordedOps.push_back(BatchOp<int,int>::upsert(4, 40));
+    recordedOps.push_back(BatchOp<int,int>::erase(2));
+    recorded.apply_batch(std::move(recordedOps));
+    recorded.pop_min();
+    recorded.stopRecording();
+    TraceReader traceReader("bst-test.trace");
+    TraceRecord traceRecord;
+    cout << "\nTrace (" << int(traceReader.header().keyBytes) << "-byte keys):";
+    while(traceReader.next(traceRecord)) {
+        int traceKey;
+        memcpy(&traceKey, traceRecord.key, sizeof(traceKey));
+        cout << " op" << traceRecord.op << "(" << traceKey << ")";
+    }
+    cout << endl;
+    remove("bst-test.trace");
+
+    // Memory usage tests
+    AVLTree<std::string,int> sized;
+    sized.insert(std::make_pair(std::string("short"), 1));
+    sized.insert(std::make_pair(std::string(40, 'x'), 2));
+    sized.setHotCache(4);
+    MemoryUsage usage = sized.memory_usage();
+    cout << "\nMemory usage: " << usage.nodes << " nodes of " << usage.nodeBytes / usage.nodes
+         << " bytes, items " << usage.itemBytes << ", key heap " << usage.heapBytes << ", slack "
+         << usage.slackBytes << ", other " << usage.otherBytes << ", total " << usage.total() << endl;
+
+    // Min/max tests
+    AVLTree<int,char> timers;
+    for(int i = 0; i < 6; ++i) {
+        timers.insert(std::make_pair((i * 7) % 10, char('a' + i)));
+    }
+    std::pair<int,char> earliest = timers.pop_min();
+    std::pair<int,char> latest = timers.pop_max();
+    cout << "\nMin/max: popped " << earliest.first << earliest.second << " and " << latest.first << latest.second
+         << ", now min " << timers.min()->first << " max " << timers.max()->first << ", size " << timers.size() << endl;
+    AVLTree<int,int> lazyTimers;
+    lazyTimers.setLazyRemove(true);
+    for(int i = 0; i < 100; ++i) {
+        lazyTimers.insert(std::make_pair(i, i));
+    }
+    lazyTimers.remove(0);
+    lazyTimers.remove(99);
+    int popped = 0;
+    while(!lazyTimers.empty()) {
+        popped % 2 == 0 ? lazyTimers.pop_min() : lazyTimers.pop_max();
+        ++popped;
+    }
+    cout << "Lazy tree popped to empty: " << popped << " pops, " << lazyTimers.getTombstoneCount()
+         << " tombstones, valid " << lazyTimers.validate() << endl;
+
+    // Write buffer tests
+    BufferedAVLTree<int,int> buf(3);
+    for(int i = 0; i < 5; ++i) {
+        buf.insert(std::make_pair(i, i));
+    }
+    buf.remove(2);
+    buf.insert(std::make_pair(1, 10));
+    buf[4] = 40;
+    cout << "\nBufferedAVLTree: size " << buf.size() << ", buffered " << buf.getBufferedCount() << endl;
+    for(BufferedAVLTree<int,int>::iterator it = buf.begin(); it != buf.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    buf.flush();
+    cout << "After flush: tree size " << buf.getTree().size() << ", buffered " << buf.getBufferedCount() << endl;
+
+    // Red-Black Tree Tests
+    RBTree<char,int> rb;
+    for(char c = 'a'; c <= 'g'; ++c) {
+        rb.insert(std::make_pair(c, c - 'a'));
+    }
+    rb.remove('d');
+    rb['e'] = 40;
+
+    cout << "\nRBTree contents:" << endl;
+    for(RBTree<char,int>::iterator it = rb.begin(); it != rb.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "RBTree valid " << rb.validate() << endl;
+
+    // Splay Tree Tests
+    SplayTree<char,int> sp;
+    for(char c = 'a'; c <= 'e'; ++c) {
+        sp.insert(std::make_pair(c, c - 'a'));
+    }
+    sp.find('b');
+    cout << "\nSplayTree contents after finding b:" << endl;
+    for(SplayTree<char,int>::iterator it = sp.begin(); it != sp.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    sp.remove('c');
+    sp.setSplayMode(SPLAY_SEMI);
+    sp.setSplayPeriod(2);
+    sp['d'] = 30;
+    cout << "SplayTree contents after removing c:" << endl;
+    for(SplayTree<char,int>::iterator it = sp.begin(); it != sp.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    SplayTree<char,int> plainSplay;
+    SplayTree<char,int> fingerSplay;
+    SplayTree<char,int>::finger splayCursor;
+    for(char c = 'a'; c <= 'e'; ++c) {
+        plainSplay.insert(std::make_pair(c, 0));
+        fingerSplay.insert(std::make_pair(c, 0));
+    }
+    plainSplay.insert(std::make_pair('a', 1));
+    fingerSplay.insert(splayCursor, std::make_pair('a', 1));
+    cout << "Overwrite splays with and without a finger: "
+         << (plainSplay.shape_stats().depthHistogram == fingerSplay.shape_stats().depthHistogram ? "same" : "different")
+         << " shape, height " << fingerSplay.shape_stats().height << endl;
+
+    // Comparator and heterogeneous lookup tests
+    AVLTree<string,int,TransparentStringLess> st;
+    st.insert(std::make_pair(string("/api/users"),1));
+    st.insert(std::make_pair(string("/api/orders"),2));
+    st.insert(std::make_pair(string("/static/app.js"),3));
+
+    const char request[] = "GET /api/orders HTTP/1.1";
+    string_view path(request + 4, 11);
+    cout << "\nString AVLTree lookups:" << endl;
+    if(st.find(path) != st.end()) {
+        cout << "Found " << st.find(path)->first << endl;
+    }
+    cout << "count(/api/users) = " << st.count(string_view("/api/users")) << endl;
+    cout << "count(/api/none) = " << st.count(string_view("/api/none")) << endl;
+    cout << "lower_bound(/b) = " << st.lower_bound(string_view("/b"))->first << endl;
+
+    // const char* keys are ordered by address under std::less<>, not by contents
+    const char labels[] = "zyxwvutsrqponmlkjihgfedcba";
+    AVLTree<const char*,int,std::less<> > pointers;
+    for(int i = 0; i < 26; ++i) {
+        pointers.insert(std::make_pair(labels + i, i));
+    }
+    cout << "const char* AVLTree valid " << pointers.validate() << ", first " << pointers.begin()->first[0] << endl;
+
+    AVLTree<int,int,std::greater<int> > rt;
+    for(int i = 1; i <= 5; ++i) {
+        rt.insert(std::make_pair(i, i * i));
+    }
+    cout << "\nDescending AVLTree contents:" << endl;
+    for(AVLTree<int,int,std::greater<int> >::iterator it = rt.begin(); it != rt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
     return 0;
 }
@@ -6,6 +6,17 @@
 #include <exception>
 #include <cstdlib>
 #include <utility>
+#include <functional>
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <type_traits>
+#include "key_prefix.h"
+#include "parallel.h"
+#include "memory_usage.h"
 
 /**
  * A templated class for a Node in a search tree.
@@ -13,9 +24,11 @@
  * that they can be overridden for future kinds of
  * search trees, such as Red Black trees, Splay trees,
  * and AVL trees.
+ * For key types with KeyPrefixTraits enabled, the node
+ * also caches a prefix of its key (see key_prefix.h).
  */
 template <typename Key, typename Value>
-class Node
+class Node : public NodeKeyPrefix<Key>
 {
 public:
     Node(const Key& key, const Value& value, Node<Key, Value>* parent);
@@ -30,6 +43,7 @@ public:
     virtual Node<Key, Value>* getParent() const;
     virtual Node<Key, Value>* getLeft() const;
     virtual Node<Key, Value>* getRight() const;
+    virtual bool isTombstone() const;
 
     void setParent(Node<Key, Value>* parent);
     void setLeft(Node<Key, Value>* left);
@@ -54,6 +68,7 @@ protected:
 */
 template<typename Key, typename Value>
 Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* parent) :
+    NodeKeyPrefix<Key>(key),
     item_(key, value),
     parent_(parent),
     left_(NULL),
@@ -145,6 +160,17 @@ Node<Key, Value>* Node<Key, Value>::getRight() const
     return right_;
 }
 
+/**
+* Trees that remove lazily leave dead nodes linked in until they are
+* purged; those nodes return true here so lookups and iteration skip
+* them. Plain nodes are never tombstones.
+*/
+template<typename Key, typename Value>
+bool Node<Key, Value>::isTombstone() const
+{
+    return false;
+}
+
 /**
 * A setter for setting the parent of a node.
 */
@@ -187,24 +213,70 @@ void Node<Key, Value>::setValue(const Value& value)
   ---------------------------------------
 */
 
+/**
+* Shape of a tree as measured by BinarySearchTree::shape_stats.
+* Depths count from 0 at the root; a successful search for a key at
+* depth d visits d + 1 nodes.
+*/
+struct ShapeStats
+{
+    size_t nodes;                       // every linked node, tombstones included
+    size_t liveNodes;                   // nodes that are not tombstones
+    int height;                         // 0 for an empty tree
+    bool heightBalanced;                // subtree heights differ by at most 1 everywhere
+    std::vector<size_t> depthHistogram; // depthHistogram[d] = nodes at depth d
+    double averageSearchDepth;          // mean nodes visited to find a live key
+};
+
+/**
+* Hints that the memory at p will be read soon. Only a hint: a no-op on
+* compilers without __builtin_prefetch.
+*/
+inline void prefetchForRead(const void* p)
+{
+#if defined(__GNUC__)
+    __builtin_prefetch(p, 0, 3);
+#endif
+}
+
 /**
 * A templated unbalanced binary search tree.
+* Keys are ordered by Compare (std::less<Key> by default).  When Compare
+* declares an is_transparent member type, find, count and lower_bound also
+* accept any type the comparator can order against Key, so lookups do not
+* need to build a temporary Key.
 */
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Compare = std::less<Key> >
 class BinarySearchTree
 {
 public:
     BinarySearchTree(); //TODO
+    explicit BinarySearchTree(const Compare& comp);
     virtual ~BinarySearchTree(); //TODO
     virtual void insert(const std::pair<const Key, Value>& keyValuePair); //TODO
     virtual void remove(const Key& key); //TODO
-    void clear(); //TODO
+    virtual void clear(); //TODO
     bool isBalanced() const; //TODO
+    bool validate(std::string* error = NULL, unsigned threads = defaultThreadCount()) const;
+    ShapeStats shape_stats(unsigned threads = defaultThreadCount()) const;
     void print() const;
+    void exportDot(std::ostream& out, int maxDepth = -1) const;
+    void exportJson(std::ostream& out, int maxDepth = -1) const;
     bool empty() const;    
-
-    template<typename PPKey, typename PPValue>
-    friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
+    size_t size() const;
+    Compare key_comp() const;
+    size_t getRotationCount() const;
+    MemoryUsage memory_usage() const;
+
+    // Optional cache of recently found nodes in front of find, count and
+    // operator[] (see setHotCache).
+    void setHotCache(size_t slots);
+    size_t getHotCacheSize() const;
+    size_t getHotCacheHits() const;
+    size_t getHotCacheMisses() const;
+
+    template<typename PPKey, typename PPValue, typename PPCompare>
+    friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue, PPCompare> & tree);
 public:
     /**
     * An internal iterator class for traversing the contents of the BST.
@@ -215,6 +287,7 @@ public:
         iterator();  // default constructor
         iterator  (const iterator& i); // copy constructor
     //    iterator  (const I& i);               // type converter
+        iterator& operator=(const iterator& rhs) = default;
 
 
         std::pair<const Key,Value>& operator*() const;
@@ -226,62 +299,198 @@ public:
         iterator& operator++();
 
     protected:
-        friend class BinarySearchTree<Key, Value>;
+        friend class BinarySearchTree<Key, Value, Compare>;
         iterator(Node<Key,Value>* ptr);
         Node<Key, Value> *current_;
     };
 
+    /**
+    * A remembered position in one tree. Searches through a finger start
+    * from the node it holds instead of from the root and leave it at
+    * the node they end on. A finger goes stale when its tree removes
+    * or frees any node; a stale (or new) finger just starts at the root.
+    */
+    class finger
+    {
+    public:
+        finger();
+
+    protected:
+        friend class BinarySearchTree<Key, Value, Compare>;
+        const BinarySearchTree<Key, Value, Compare>* tree_;
+        Node<Key, Value>* node_;
+        size_t epoch_;
+    };
+
     public:
     iterator begin() const;
     iterator end() const;
     iterator find(const Key& key) const;
+    size_t count(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+    // The smallest and largest items, kept cached (end() when empty); the
+    // pops remove and return them, throwing std::out_of_range when empty.
+    iterator min() const;
+    iterator max() const;
+    std::pair<Key, Value> pop_min();
+    std::pair<Key, Value> pop_max();
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
     iterator begin(){
-        return iterator(getSmallestNode());
+        return iterator(skipTombstones(leftmost_));
     }
     iterator end(){
         return iterator(nullptr);
     }
 
-    /*
-    iterator& operator++(){
-        if (root_ == nullptr) {
-            return * this;
-        }
-        if (root_->getRight() != nullptr) {
-            root_ = getSmallestNode(root_->getRight());
-        } else {
-            auto parent = root_->getParent();
-            while (parent != nullptr && root_ == parent->getRight()) {
-                root_ = parent;
-                parent = parent->getParent();
-            }
-            root_ = parent;
-        }
-        return * this;
-    }
-     */
+    // Heterogeneous lookups, only available with a transparent comparator.
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator find(const K& key) const;
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    size_t count(const K& key) const;
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator lower_bound(const K& key) const;
+
+    // Finger searches (see fingerStart).
+    iterator find(finger& f, const Key& key) const;
+    iterator lower_bound(finger& f, const Key& key) const;
+    void insert(finger& f, const std::pair<const Key, Value>& keyValuePair);
+
+    // Internal iteration in key order, skipping lazily removed nodes.
+    // f must not insert into or remove from the tree.
+    template<typename F>
+    void for_each(F f) const;
+    template<typename F>
+    void for_each_range(const Key& lo, const Key& hi, F f) const;
+    template<typename F>
+    bool visit(F f) const;
+
+    // The same split across threads. f is called concurrently and must be
+    // safe to call from several threads at once.
+    template<typename F>
+    void parallel_for_each(F f, unsigned threads = defaultThreadCount()) const;
+    template<typename F>
+    void parallel_for_each_range(const Key& lo, const Key& hi, F f, unsigned threads = defaultThreadCount()) const;
+    template<typename T, typename Map, typename Combine>
+    T parallel_reduce(const T& identity, Map map, Combine combine, unsigned threads = defaultThreadCount()) const;
+    template<typename T, typename Map, typename Combine>
+    T parallel_reduce_range(const Key& lo, const Key& hi, const T& identity, Map map, Combine combine,
+        unsigned threads = defaultThreadCount()) const;
+
 protected:
     // Mandatory helper functions
-    Node<Key, Value>* internalFind(const Key& k) const; // TODO
-    Node<Key, Value> *getSmallestNode() const;  // TODO
+    template<typename K>
+    Node<Key, Value>* internalFind(const K& k) const; // TODO
     static Node<Key, Value>* predecessor(Node<Key, Value>* current); // TODO
     static Node<Key,Value>* successor(Node<Key, Value> * current);
+    static Node<Key,Value>* skipTombstones(Node<Key, Value> * current);
+    static Node<Key,Value>* skipTombstonesBack(Node<Key, Value> * current);
     // Note:  static means these functions don't have a "this" pointer
     //        and instead just use the input argument.
 
     // Provided helper functions
-    virtual void printRoot (Node<Key, Value> *r) const;
+    void printRoot (Node<Key, Value> *r) const;
     virtual void nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2) ;
+    virtual void removeNode(Node<Key, Value>* n);
+    virtual void eraseNode(Node<Key, Value>* n);
 
     // Add helper functions here
-    Node<Key, Value>* recursiveFind(Node<Key,Value>*node,const Key& key) const;
-    Node<Key, Value>* recursiveRemove(Node<Key,Value>*node,const Key& key);
+    typedef typename KeyPrefixTraits<Key>::type KeyPrefix;
+    static const bool usesKeyPrefix =
+        KeyPrefixTraits<Key>::enabled && IsLexicographicCompare<Compare>::value;
+    template<typename K>
+    KeyPrefix probePrefix(const K& key) const;
+    template<typename K>
+    int compareToNode(const K& key, KeyPrefix prefix, const Node<Key,Value>* node) const;
+    template<typename K>
+    Node<Key, Value>* internalLowerBound(const K& key) const;
+    Node<Key, Value>* cachedFind(const Key& key) const;
+    Node<Key, Value>* fingerStart(const finger& f, const Key& key) const;
+    Node<Key, Value>* fingerDescend(Node<Key, Value>* start, const Key& key, Node<Key, Value>*& last,
+        int& cmp) const;
+    virtual Node<Key, Value>* linkLeaf(const std::pair<const Key, Value>& keyValuePair, Node<Key, Value>* parent,
+        int cmp);
+    virtual void overwriteNode(Node<Key, Value>* n, const Value& value);
+    size_t hotCacheSet(const Key& key) const;
+    void forgetNode(Node<Key, Value>* n);
+    void forgetAllNodes();
+    void noteLinked(Node<Key, Value>* n);
+    void noteUnlinking(Node<Key, Value>* n);
     void DestroyRecursive(Node<Key,Value> * node);
+    void rotateLeft(Node<Key, Value>* n);
+    void rotateRight(Node<Key, Value>* n);
+    // Lets derived trees hand out iterators to their own nodes.
+    static iterator makeIterator(Node<Key, Value>* n){
+        return iterator(n);
+    }
+    static Node<Key, Value>* iteratorNode(const iterator& it){
+        return it.current_;
+    }
+    virtual bool checkNode(const Node<Key, Value>* n, int leftHeight, int rightHeight) const;
+    // Size of the tree's node type, and its linked nodes (tombstones included).
+    virtual size_t nodeBytes() const;
+    virtual size_t linkedNodes() const;
+
+    // Results of checking one subtree for validate and shape_stats.
+    struct SubtreeCheck
+    {
+        SubtreeCheck() : root(NULL), depth(0), lo(NULL), hi(NULL), height(0), nodes(0),
+            liveNodes(0), depthSum(0), heightBalanced(true) { }
+
+        Node<Key, Value>* root;
+        int depth;                      // depth of root in the whole tree
+        const Key* lo;                  // keys must order strictly after *lo, if set
+        const Key* hi;                  // and strictly before *hi, if set
+        int height;
+        size_t nodes;
+        size_t liveNodes;
+        unsigned long long depthSum;    // over live nodes, root of the whole tree at 0
+        bool heightBalanced;
+        std::string error;
+        std::vector<size_t> depthHistogram;
+    };
+    void checkSubtree(SubtreeCheck& check) const;
+    int checkTop(Node<Key, Value>* n, int depth, const Key* lo, const Key* hi, int cutDepth,
+        bool collect, std::vector<SubtreeCheck>& parts, size_t& next, SubtreeCheck& top) const;
+    void inspect(ShapeStats& stats, std::string& error, unsigned threads) const;
+    template<typename F>
+    bool walkInOrder(Node<Key, Value>* start, const Key* lo, const Key* hi, F& f) const;
+
+    // A piece of a parallel walk: the whole subtree under node, or just
+    // node itself. A tree's pieces, in order, cover it in key order.
+    struct WorkUnit
+    {
+        Node<Key, Value>* node;
+        bool whole;
+    };
+    void planWork(const Key* lo, const Key* hi, std::vector<WorkUnit>& units) const;
+    void splitWork(Node<Key, Value>* n, int depth, int cutDepth, const Key* lower, const Key* upper,
+        const Key* lo, const Key* hi, std::vector<WorkUnit>& units) const;
+    template<typename F>
+    void runWork(const WorkUnit& unit, const Key* lo, const Key* hi, F& f) const;
+    template<typename F>
+    void parallelWalk(const Key* lo, const Key* hi, F& f, unsigned threads) const;
+    template<typename T, typename Map, typename Combine>
+    T parallelReduce(const Key* lo, const Key* hi, const T& identity, Map& map, Combine& combine,
+        unsigned threads) const;
+    void summarizeSubtree(Node<Key, Value>* n, size_t& nodes, int& height,
+        Node<Key, Value>*& minNode, Node<Key, Value>*& maxNode,
+        std::vector<std::pair<Node<Key, Value>*, int> >& scratch) const;
 
     Node<Key, Value>* root_;
-    // You should not need other data members
+    // first and last linked nodes (tombstones included), NULL when empty
+    Node<Key, Value>* leftmost_;
+    Node<Key, Value>* rightmost_;
+    Compare comp_;
+    size_t rotations_;
+    size_t size_;
+    // two ways per set, most recently used first; empty when disabled
+    mutable std::vector<Node<Key, Value>*> hotCache_;
+    int hotCacheBits_;
+    mutable size_t hotHits_;
+    mutable size_t hotMisses_;
+    // bumped whenever a node may be freed, which makes fingers stale
+    size_t fingerEpoch_;
 };
 
 /*
@@ -293,8 +502,8 @@ Begin implementations for the BinarySearchTree::iterator class.
 /**
 * Explicit constructor that initializes an iterator with a given node pointer.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::iterator::iterator(Node<Key,Value> *ptr)
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::iterator::iterator(Node<Key,Value> *ptr)
 {
 
     current_ = ptr;
@@ -304,18 +513,28 @@ BinarySearchTree<Key, Value>::iterator::iterator(Node<Key,Value> *ptr)
 /**
 * A default constructor that initializes the iterator to NULL.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::iterator::iterator() 
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::iterator::iterator() 
 {
     current_ =NULL;
 }
 
+/**
+* A copy constructor that points at the same node as i.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::iterator::iterator(const iterator& i) :
+    current_(i.current_)
+{
+
+}
+
 /**
 * Provides access to the item.
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 std::pair<const Key,Value> &
-BinarySearchTree<Key, Value>::iterator::operator*() const
+BinarySearchTree<Key, Value, Compare>::iterator::operator*() const
 {
     return current_->getItem();
 }
@@ -323,9 +542,9 @@ BinarySearchTree<Key, Value>::iterator::operator*() const
 /**
 * Provides access to the address of the item.
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 std::pair<const Key,Value> *
-BinarySearchTree<Key, Value>::iterator::operator->() const
+BinarySearchTree<Key, Value, Compare>::iterator::operator->() const
 {
     return &(current_->getItem());
 }
@@ -334,10 +553,10 @@ BinarySearchTree<Key, Value>::iterator::operator->() const
 * Checks if 'this' iterator's internals have the same value
 * as 'rhs'
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 bool
-BinarySearchTree<Key, Value>::iterator::operator==(
-    const BinarySearchTree<Key, Value>::iterator& rhs) const
+BinarySearchTree<Key, Value, Compare>::iterator::operator==(
+    const BinarySearchTree<Key, Value, Compare>::iterator& rhs) const
 {
     // TODO
     return current_ == rhs.current_;
@@ -347,10 +566,10 @@ BinarySearchTree<Key, Value>::iterator::operator==(
 * Checks if 'this' iterator's internals have a different value
 * as 'rhs'
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 bool
-BinarySearchTree<Key, Value>::iterator::operator!=(
-    const BinarySearchTree<Key, Value>::iterator& rhs) const
+BinarySearchTree<Key, Value, Compare>::iterator::operator!=(
+    const BinarySearchTree<Key, Value, Compare>::iterator& rhs) const
 {
     // TODO
     return current_!= rhs.current_;
@@ -360,11 +579,11 @@ BinarySearchTree<Key, Value>::iterator::operator!=(
 /**
 * Advances the iterator's location using an in-order sequencing
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator&
-BinarySearchTree<Key, Value>::iterator::operator++()
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator&
+BinarySearchTree<Key, Value, Compare>::iterator::operator++()
 {
-    current_ = successor(current_);
+    current_ = skipTombstones(successor(current_));
         return * this;
         //use the successor code to advance the iterator successor to advance the position of the iterator
 
@@ -372,6 +591,17 @@ BinarySearchTree<Key, Value>::iterator::operator++()
 
 
 
+/**
+* A finger that holds no position yet; the first search starts at the
+* root.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::finger::finger() :
+    tree_(NULL), node_(NULL), epoch_(0)
+{
+
+}
+
 /*
 -------------------------------------------------------------
 End implementations for the BinarySearchTree::iterator class.
@@ -387,15 +617,43 @@ Begin implementations for the BinarySearchTree class.
 /**
 * Default constructor for a BinarySearchTree, which sets the root to NULL.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::BinarySearchTree() 
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree() :
+    leftmost_(nullptr),
+    rightmost_(nullptr),
+    comp_(),
+    rotations_(0),
+    size_(0),
+    hotCacheBits_(0),
+    hotHits_(0),
+    hotMisses_(0),
+    fingerEpoch_(0)
 {
     // TODO
     root_= nullptr;
 }
 
-template<typename Key, typename Value>
-BinarySearchTree<Key, Value>::~BinarySearchTree()
+/**
+* Constructor for a BinarySearchTree ordered by the given comparator.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree(const Compare& comp) :
+    root_(nullptr),
+    leftmost_(nullptr),
+    rightmost_(nullptr),
+    comp_(comp),
+    rotations_(0),
+    size_(0),
+    hotCacheBits_(0),
+    hotHits_(0),
+    hotMisses_(0),
+    fingerEpoch_(0)
+{
+
+}
+
+template<typename Key, typename Value, typename Compare>
+BinarySearchTree<Key, Value, Compare>::~BinarySearchTree()
 {
     // TODO
     DestroyRecursive(root_);
@@ -404,415 +662,1515 @@ BinarySearchTree<Key, Value>::~BinarySearchTree()
 /**
  * Returns true if tree is empty
 */
-template<class Key, class Value>
-bool BinarySearchTree<Key, Value>::empty() const
+template<class Key, class Value, class Compare>
+bool BinarySearchTree<Key, Value, Compare>::empty() const
 {
-    return root_ == NULL;
+    return size_ == 0;
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::print() const
+/**
+ * Returns the number of items in the tree
+*/
+template<class Key, class Value, class Compare>
+size_t BinarySearchTree<Key, Value, Compare>::size() const
 {
-    printRoot(root_);
-    std::cout << "\n";
+    return size_;
 }
 
 /**
-* Returns an iterator to the "smallest" item in the tree
+ * Returns a copy of the comparator used to order the keys
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::begin() const
+template<class Key, class Value, class Compare>
+Compare BinarySearchTree<Key, Value, Compare>::key_comp() const
 {
-    BinarySearchTree<Key, Value>::iterator begin(getSmallestNode());
-    return begin;
+    return comp_;
 }
 
 /**
-* Returns an iterator whose value means INVALID
+ * Returns how many rotations the balancing code has performed
+ * over the lifetime of the tree
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::end() const
+template<class Key, class Value, class Compare>
+size_t BinarySearchTree<Key, Value, Compare>::getRotationCount() const
 {
-    BinarySearchTree<Key, Value>::iterator end(NULL);
-    return end;
+    return rotations_;
 }
 
 /**
-* Returns an iterator to the item with the given key, k
-* or the end iterator if k does not exist in the tree
+* Reports the memory the tree uses (see MemoryUsage). Without a
+* HeapUsageTraits specialization for the key or value type this is O(1)
+* and cheap enough for a metrics endpoint; with one, every node is
+* visited to add up what its key and value own.
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::find(const Key & k) const
+template<class Key, class Value, class Compare>
+MemoryUsage BinarySearchTree<Key, Value, Compare>::memory_usage() const
 {
-    Node<Key, Value> *curr = internalFind(k);
-    BinarySearchTree<Key, Value>::iterator it(curr);
-    return it;
+    MemoryUsage usage;
+    usage.nodes = linkedNodes();
+    usage.nodeBytes = usage.nodes * nodeBytes();
+    usage.itemBytes = usage.nodes * sizeof(std::pair<const Key, Value>);
+    usage.heapBytes = 0;
+    usage.slackBytes = usage.nodes * (allocationBytes(nodeBytes()) - nodeBytes());
+    usage.otherBytes = hotCache_.capacity() * sizeof(Node<Key, Value>*);
+    if (HeapUsageTraits<Key>::enabled || HeapUsageTraits<Value>::enabled) {
+        std::vector<Node<Key, Value>*> pending;
+        if (root_ != NULL) {
+            pending.push_back(root_);
+        }
+        while (!pending.empty()) {
+            Node<Key, Value>* n = pending.back();
+            pending.pop_back();
+            usage.heapBytes += HeapUsageTraits<Key>::bytes(n->getKey()) +
+                HeapUsageTraits<Value>::bytes(n->getValue());
+            if (n->getLeft() != NULL) {
+                pending.push_back(n->getLeft());
+            }
+            if (n->getRight() != NULL) {
+                pending.push_back(n->getRight());
+            }
+        }
+    }
+    return usage;
 }
 
-/**
- * @precondition The key exists in the map
- * Returns the value associated with the key
- */
-template<class Key, class Value>
-Value& BinarySearchTree<Key, Value>::operator[](const Key& key)
+template<class Key, class Value, class Compare>
+size_t BinarySearchTree<Key, Value, Compare>::nodeBytes() const
 {
-    Node<Key, Value> *curr = internalFind(key);
-    if(curr == NULL) throw std::out_of_range("Invalid key");
-    return curr->getValue();
+    return sizeof(Node<Key, Value>);
 }
-template<class Key, class Value>
-Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
+
+template<class Key, class Value, class Compare>
+size_t BinarySearchTree<Key, Value, Compare>::linkedNodes() const
 {
-    Node<Key, Value> *curr = internalFind(key);
-    if(curr == NULL) throw std::out_of_range("Invalid key");
-    return curr->getValue();
+    return size_;
 }
 
 /**
-* An insert method to insert into a Binary Search Tree.
-* The tree will not remain balanced when inserting.
-* Recall: If key is already in the tree, you should 
-* overwrite the current value with the updated value.
+* Puts a 2-way set-associative cache of slots (rounded up to a power of
+* two, at least 2) node pointers in front of find, count and operator[],
+* for workloads that keep looking up a few hot keys: a hit costs a hash
+* and a key comparison instead of a descent. 0 turns the cache off,
+* which is the default. Resizing empties the cache and resets its
+* counters.
+*
+* Lookups that hit or fill the cache write to it, so with the cache on,
+* const lookups must not run concurrently. Keys need a std::hash
+* specialization; for other key types the cache stays off.
 */
-template<class Key, class Value>
-void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair)
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::setHotCache(size_t slots)
 {
-    // create a new item and walk down to insert it into the tree
-    const Key key = keyValuePair.first;
-    Value value = keyValuePair.second;
-
-    Node<Key, Value> *searchedNode = internalFind(key);
-    if (searchedNode) {
-        searchedNode->setValue(value);
-        return;
-    }
-    if (!root_) {
-        root_ = new Node<Key, Value>(key, value, nullptr);
-        return;
-    }
-
-    Node<Key, Value> *parent = nullptr;
-    Node<Key, Value> *traversalNode = root_;
-    Node<Key, Value> *newNode = new Node<Key, Value>(key, value, parent);
-
-    while (traversalNode) {
-       // parent = traversalNode;
-       if((newNode->getKey()<traversalNode->getKey())&& (traversalNode->getLeft()==NULL)){
-           //insert left
-           traversalNode->setLeft(newNode);
-           newNode->setParent(traversalNode);
-           break;
-       } else if(newNode->getKey()<traversalNode->getKey()){
-           traversalNode = traversalNode->getLeft();
-       } else if((newNode->getKey()>traversalNode->getKey())&& (traversalNode->getRight()==NULL)){
-            //insert right
-            traversalNode->setRight(newNode);
-            newNode->setParent(traversalNode);
-            break;
-        } else{
-           traversalNode = traversalNode->getRight();
-       }
-
+    hotCache_.clear();
+    hotCacheBits_ = 0;
+    hotHits_ = 0;
+    hotMisses_ = 0;
+    if constexpr (std::is_default_constructible<std::hash<Key> >::value) {
+        if (slots == 0) {
+            return;
+        }
+        while ((size_t(2) << hotCacheBits_) < slots) {
+            ++hotCacheBits_;
+        }
+        hotCache_.assign(size_t(2) << hotCacheBits_, NULL);
     }
 }
 
+template<class Key, class Value, class Compare>
+size_t BinarySearchTree<Key, Value, Compare>::getHotCacheSize() const
+{
+    return hotCache_.size();
+}
 
-
-template<class Key, class Value>
-void BinarySearchTree<Key, Value>::DestroyRecursive(Node<Key,Value> * node)
+template<class Key, class Value, class Compare>
+size_t BinarySearchTree<Key, Value, Compare>::getHotCacheHits() const
 {
-    if (node)
-    {
-        DestroyRecursive(node->getLeft());
-        DestroyRecursive(node->getRight());
-        delete node;
-    }
+    return hotHits_;
 }
-/*
-template<class Key, class Value>
-Node<Key,Value>* insertRecursive(Node<Key,Value> *r, Node<Key,Value> *new_node)
+
+template<class Key, class Value, class Compare>
+size_t BinarySearchTree<Key, Value, Compare>::getHotCacheMisses() const
 {
-    if(r==NULL)
-    {
-        r=new_node;
-        return r;
-    }
+    return hotMisses_;
+}
 
-    if(new_node->getKey() < r->getKey())
-    {
-        r->setLeft( insertRecursive(r->getLeft(),new_node));
-    }
-    else if (new_node->getKey() > r->getKey())
-    {
-        r->setRight( insertRecursive(r->getRight(),new_node));
-    }
-    else
-    {
-        return r;
-    }
-    return r;
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::print() const
+{
+    printRoot(root_);
+    std::cout << "\n";
 }
-*/
 
 /**
-* A remove method to remove a specific key from a Binary Search Tree.
-* Recall: The writeup specifies that if a node has 2 children you
-* should swap with the predecessor and then remove.
+* Returns an iterator to the "smallest" item in the tree
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::remove(const Key& key) {
-    Node<Key, Value> *searchedNode = internalFind(key);
-
-    if (!searchedNode) {
-        return;
-    }
-    Node<Key, Value> *searchedNodeParent = searchedNode->getParent();
-    Node<Key, Value> *replacementNode = recursiveRemove(searchedNode,key);
-    //root node
-    if(searchedNodeParent== nullptr){
-        root_ = replacementNode;
-    }
-    /*
-    if(recursiveRemove(searchedNode,key)== nullptr)
-    {
-        //root node
-        if(searchedNodeParent== nullptr) {
-            root_ = nullptr;
-        }
-    }*/
-
-    return;
-
-    //If the searched node has 2 children swap with its predecessor
-    //If it has only left or right child just promote the child
-    /*
-    if((searchedNode->getRight()!= nullptr) && (searchedNode->getLeft()!= nullptr)){
-        nodeSwap(searchedNode,predecessor(searchedNode));
-    } else if(searchedNode->getRight()!= nullptr){
-        searchedNode->getParent()->setLeft(searchedNode->getRight());
-
-    }else if(searchedNode->getLeft()!= nullptr){
-        searchedNode->getParent()->setLeft(searchedNode->getLeft());
-    }
-    else{
-        delete searchedNode;
-    }
-    return;
-     */
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::begin() const
+{
+    BinarySearchTree<Key, Value, Compare>::iterator begin(skipTombstones(leftmost_));
+    return begin;
 }
 
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::recursiveRemove(Node<Key,Value>*node,const Key& key)
+/**
+* Returns an iterator whose value means INVALID
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::end() const
 {
-    // TODO
-    // If the key of the node to be deleted is smaller than the current node's key,
-    // then it will be in left subtree
-    if (node == nullptr) {
-        return nullptr;
-    } else if (key < node->getKey()) {
-        node->setLeft(recursiveRemove(node->getLeft(), key));
-    }
-    // If the key of the node to be deleted is smaller than the current node's key,
-    // then it will be in left subtree
-    else if (key > node->getKey()) {
-        node->setRight(recursiveRemove(node->getRight(), key));
-    }else {
-        if (node->getLeft()== nullptr) {
-            Node<Key,Value> * temp = node->getRight();
-            if(temp) {
-                temp->setParent(node->getParent());
-            }
-            if(node->getParent()) {
-                if(node==node->getParent()->getLeft())
-                {
-                    node->getParent()->setLeft(nullptr);
-                }else if(node==node->getParent()->getRight())
-                {
-                    node->getParent()->setRight(nullptr);
-                }
-            }
-            delete node;
-            node= nullptr;
-            return temp;
-        } else if((node->getRight()== nullptr)){
-            Node<Key,Value> * temp = node->getLeft();
-            if(temp) {
-                temp->setParent(node->getParent());
-            }
-            if(node->getParent()) {
-                if(node==node->getParent()->getLeft())
-                {
-                    node->getParent()->setLeft(nullptr);
-                }else if(node==node->getParent()->getRight())
-                {
-                    node->getParent()->setRight(nullptr);
-                }
-            }
-            delete node;
-            node= nullptr;
-            return temp;
-        } else{
-            // node with two children. Find the inorder successor smallest node in the right tree
-            nodeSwap(node,successor(node));
+    BinarySearchTree<Key, Value, Compare>::iterator end(NULL);
+    return end;
+}
 
-            /* Node<Key,Value> * temp = successor(node);
-            node->setValue(temp->getValue());
-            node->setParent(temp->getParent());*/
-            recursiveRemove(successor(node), successor(node)->getKey());
-        }
-    }
-   return node;
+/**
+* Returns an iterator to the smallest item, or end() if the tree is
+* empty. O(1) from the cached leftmost node (plus any tombstones).
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::min() const
+{
+    return iterator(skipTombstones(leftmost_));
 }
 
-template<class Key, class Value>
-Node<Key, Value>*
-BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current)
+/**
+* Returns an iterator to the largest item, or end() if the tree is
+* empty. O(1) from the cached rightmost node (plus any tombstones).
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::max() const
 {
-    if(current== nullptr)
-        return nullptr;
-    // The max value within the left subtree will be the predecessor
-    if (current->getLeft()!= nullptr){
-        Node<Key, Value>* tmp= current->getLeft();
-        while (tmp->getRight())
-            tmp=tmp->getRight();
-        current=tmp;
-    }
-    return current;
+    return iterator(skipTombstonesBack(rightmost_));
 }
 
-template<class Key, class Value>
-Node<Key, Value>*
-BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current)
+/**
+* Removes the smallest item and returns a copy of it. The node is
+* unlinked directly, without a search from the root; an AVL or
+* red-black tree then rebalances in amortized O(1). Pops never leave
+* tombstones, even with lazy removal on, and unlink any that lazy
+* removes left at the front, so each is skipped at most once.
+*/
+template<class Key, class Value, class Compare>
+std::pair<Key, Value> BinarySearchTree<Key, Value, Compare>::pop_min()
 {
-    if(current== nullptr)
-        return nullptr;
-    // The max value within the left subtree will be the predecessor
-    if (current->getLeft()!= nullptr){
-        Node<Key, Value>* tmp= current->getRight();
-        while (tmp->getLeft())
-            tmp=tmp->getLeft();
-        current=tmp;
+    Node<Key, Value>* n = leftmost_;
+    while(n != NULL && n->isTombstone()) {
+        eraseNode(n);
+        n = leftmost_;
     }
-    return current;
+    if(n == NULL) throw std::out_of_range("Empty tree");
+    std::pair<Key, Value> item(n->getKey(), n->getValue());
+    eraseNode(n);
+    return item;
 }
 
-
 /**
-* A method to remove all contents of the tree and
-* reset the values in the tree for use again.
+* Removes the largest item and returns a copy of it, like pop_min.
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::clear()
+template<class Key, class Value, class Compare>
+std::pair<Key, Value> BinarySearchTree<Key, Value, Compare>::pop_max()
 {
-    //
-    Node<Key,Value> *node = root_;
-    if(node) {
-        DestroyRecursive(root_->getRight());
-        DestroyRecursive(root_->getLeft());
+    Node<Key, Value>* n = rightmost_;
+    while(n != NULL && n->isTombstone()) {
+        eraseNode(n);
+        n = rightmost_;
     }
-    root_ = nullptr;
-    delete node;
-    return;
+    if(n == NULL) throw std::out_of_range("Empty tree");
+    std::pair<Key, Value> item(n->getKey(), n->getValue());
+    eraseNode(n);
+    return item;
 }
 
-
 /**
-* A helper function to find the smallest node in the tree.
+* Returns an iterator to the item with the given key, k
+* or the end iterator if k does not exist in the tree
 */
-template<typename Key, typename Value>
-Node<Key, Value>*
-BinarySearchTree<Key, Value>::getSmallestNode() const
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::find(const Key & k) const
 {
-    // TODO
-    return findSmallestNode(root_->getLeft());
-}
-template<typename Key, typename Value>
-Node<Key, Value> *findSmallestNode(Node<Key, Value> * root){
-    if(root == nullptr || root->getLeft() == nullptr) {
-        return root;
-    }
-    return findSmallestNode(root->getLeft());
+    Node<Key, Value> *curr = cachedFind(k);
+    BinarySearchTree<Key, Value, Compare>::iterator it(curr);
+    return it;
 }
 
 /**
-* Helper function to find a node with given key, k and
-* return a pointer to it or NULL if no item with that key
-* exists
+* Heterogeneous find: k may be any type the transparent comparator
+* can order against Key.
 */
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const
+template<class Key, class Value, class Compare>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::find(const K & k) const
 {
-    // TODO
-    Node<Key, Value> *curr = root_;
-    return recursiveFind(root_, key);
+    return iterator(internalFind(k));
+}
 
-    /*
-    while(curr && curr->getKey() != key) {
-        if(key < curr->getKey()){
-            curr = curr->getLeft();
-        }
+/**
+* Returns 1 if the key is in the tree and 0 otherwise
+*/
+template<class Key, class Value, class Compare>
+size_t BinarySearchTree<Key, Value, Compare>::count(const Key & k) const
+{
+    return cachedFind(k) != NULL ? 1 : 0;
+}
+
+template<class Key, class Value, class Compare>
+template<typename K, typename C, typename>
+size_t BinarySearchTree<Key, Value, Compare>::count(const K & k) const
+{
+    return internalFind(k) != NULL ? 1 : 0;
+}
+
+/**
+* Returns an iterator to the first item whose key is not less than k,
+* or the end iterator if there is no such item
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::lower_bound(const Key & k) const
+{
+    return iterator(internalLowerBound(k));
+}
+
+template<class Key, class Value, class Compare>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::lower_bound(const K & k) const
+{
+    return iterator(internalLowerBound(k));
+}
+
+/**
+* Returns the node a search for key should start from: the lowest
+* ancestor of the finger's node whose subtree must hold key's position,
+* or the root if the finger is stale.
+*
+* Going up from a node that hangs right of its parent raises the lower
+* bound of the subtree to the parent's key (and symmetrically on the
+* left), so the climb stops at the first such parent past key. The climb
+* and the descent after it take O(log d) steps in a balanced tree for a
+* key d positions away, except where the path between the two crosses a
+* high ancestor: neighbours on either side of the root still cost
+* O(log n). Over a sorted run of searches that averages out to O(1)
+* climbing per search.
+*/
+template<class Key, class Value, class Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::fingerStart(const finger& f, const Key& key) const
+{
+    if (f.tree_ != this || f.node_ == NULL || f.epoch_ != fingerEpoch_) {
+        return root_;
+    }
+    Node<Key, Value>* curr = f.node_;
+    if (comp_(key, curr->getKey())) {
+        for (Node<Key, Value>* parent = curr->getParent(); parent != NULL;
+             curr = parent, parent = curr->getParent()) {
+            if (curr == parent->getRight() && !comp_(key, parent->getKey())) {
+                return comp_(parent->getKey(), key) ? curr : parent;
+            }
+        }
+    }
+    else if (comp_(curr->getKey(), key)) {
+        for (Node<Key, Value>* parent = curr->getParent(); parent != NULL;
+             curr = parent, parent = curr->getParent()) {
+            if (curr == parent->getLeft() && !comp_(parent->getKey(), key)) {
+                return comp_(key, parent->getKey()) ? curr : parent;
+            }
+        }
+    }
+    return curr;
+}
+
+/**
+* Descends from start toward key. Returns the node holding key (which may
+* be a tombstone), or NULL after setting last and cmp to the last node
+* visited and the side of it where key belongs.
+*/
+template<class Key, class Value, class Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::fingerDescend(Node<Key, Value>* start, const Key& key,
+    Node<Key, Value>*& last, int& cmp) const
+{
+    const KeyPrefix prefix = probePrefix(key);
+    Node<Key, Value>* curr = start;
+    last = NULL;
+    cmp = 0;
+    while (curr != NULL) {
+        cmp = compareToNode(key, prefix, curr);
+        if (cmp == 0) {
+            return curr;
+        }
+        last = curr;
+        curr = (cmp < 0) ? curr->getLeft() : curr->getRight();
+    }
+    return NULL;
+}
+
+/**
+* find starting from the finger, which is left at the node found or,
+* on a miss, at the last node visited.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::find(finger& f, const Key& key) const
+{
+    Node<Key, Value>* last;
+    int cmp;
+    Node<Key, Value>* n = fingerDescend(fingerStart(f, key), key, last, cmp);
+    Node<Key, Value>* at = (n != NULL) ? n : last;
+    if (at != NULL) {
+        f.tree_ = this;
+        f.node_ = at;
+        f.epoch_ = fingerEpoch_;
+    }
+    return iterator((n != NULL && !n->isTombstone()) ? n : NULL);
+}
+
+/**
+* lower_bound starting from the finger, which is left where the descent
+* ended.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::lower_bound(finger& f, const Key& key) const
+{
+    Node<Key, Value>* last;
+    int cmp;
+    Node<Key, Value>* n = fingerDescend(fingerStart(f, key), key, last, cmp);
+    Node<Key, Value>* result = n;
+    if (n == NULL && last != NULL) {
+        // key would hang off last; if on its right, the next key up is
+        // last's successor, which may be above the subtree searched
+        result = (cmp < 0) ? last : successor(last);
+    }
+    Node<Key, Value>* at = (n != NULL) ? n : last;
+    if (at != NULL) {
+        f.tree_ = this;
+        f.node_ = at;
+        f.epoch_ = fingerEpoch_;
+    }
+    return iterator(skipTombstones(result));
+}
+
+/**
+* insert starting from the finger, which is left at the inserted (or
+* overwritten) node. The new node is linked and rebalanced the same way
+* insert does it.
+*/
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::insert(finger& f, const std::pair<const Key, Value>& keyValuePair)
+{
+    Node<Key, Value>* last;
+    int cmp;
+    Node<Key, Value>* n = fingerDescend(fingerStart(f, keyValuePair.first), keyValuePair.first, last, cmp);
+    if (n != NULL) {
+        overwriteNode(n, keyValuePair.second);
+    }
+    else {
+        n = linkLeaf(keyValuePair, last, cmp);
+    }
+    f.tree_ = this;
+    f.node_ = n;
+    f.epoch_ = fingerEpoch_;
+}
+
+/**
+* Calls f(item) for every item, in key order. item is the same
+* std::pair<const Key, Value>& an iterator dereferences to.
+*
+* Unlike an iterator loop, which finds each successor through parent
+* links, this walks down with an explicit stack of pending ancestors and
+* prefetches each right child as its parent is stacked, so that the
+* load is under way by the time the walk comes back up to it. f is a
+* template parameter so that it can be inlined into the loop.
+*/
+template<class Key, class Value, class Compare>
+template<typename F>
+void BinarySearchTree<Key, Value, Compare>::for_each(F f) const
+{
+    auto always = [&f](std::pair<const Key, Value>& item) {
+        f(item);
+        return true;
+    };
+    walkInOrder(root_, NULL, NULL, always);
+}
+
+/**
+* Calls f(item) for every item with lo <= key < hi, in key order.
+*/
+template<class Key, class Value, class Compare>
+template<typename F>
+void BinarySearchTree<Key, Value, Compare>::for_each_range(const Key& lo, const Key& hi, F f) const
+{
+    auto always = [&f](std::pair<const Key, Value>& item) {
+        f(item);
+        return true;
+    };
+    walkInOrder(root_, &lo, &hi, always);
+}
+
+/**
+* Calls f(item) in key order until f returns false. Returns true if
+* every item was visited, false if f stopped the walk.
+*/
+template<class Key, class Value, class Compare>
+template<typename F>
+bool BinarySearchTree<Key, Value, Compare>::visit(F f) const
+{
+    return walkInOrder(root_, NULL, NULL, f);
+}
+
+/**
+* In-order walk of the subtree under start, limited to lo <= key < hi
+* where those are set, calling f on each live item until it returns
+* false. Returns false if f stopped the walk.
+*/
+template<class Key, class Value, class Compare>
+template<typename F>
+bool BinarySearchTree<Key, Value, Compare>::walkInOrder(Node<Key, Value>* start, const Key* lo, const Key* hi,
+    F& f) const
+{
+    Node<Key, Value>* stackBuffer[64];
+    std::vector<Node<Key, Value>*> overflow;
+    Node<Key, Value>** stack = stackBuffer;
+    size_t depth = 0;
+    size_t capacity = 64;
+
+    Node<Key, Value>* curr = start;
+    bool seeking = (lo != NULL);
+    while (true) {
+        while (curr != NULL) {
+            if (seeking && comp_(curr->getKey(), *lo)) {
+                // curr and its left subtree are below the range
+                curr = curr->getRight();
+                continue;
+            }
+            if (depth == capacity) {
+                // deeper than any balanced tree gets; move to the heap
+                if (stack == stackBuffer) {
+                    overflow.assign(stackBuffer, stackBuffer + depth);
+                }
+                capacity *= 2;
+                overflow.resize(capacity);
+                stack = &overflow[0];
+            }
+            stack[depth++] = curr;
+            Node<Key, Value>* right = curr->getRight();
+            if (right != NULL) {
+                prefetchForRead(right);
+            }
+            curr = curr->getLeft();
+        }
+        // every later node is at or above lo
+        seeking = false;
+        if (depth == 0) {
+            return true;
+        }
+        Node<Key, Value>* n = stack[--depth];
+        if (hi != NULL && !comp_(n->getKey(), *hi)) {
+            return true;
+        }
+        if (!n->isTombstone() && !f(n->getItem())) {
+            return false;
+        }
+        curr = n->getRight();
+    }
+}
+
+/**
+* Calls f(item) for every item, from up to threads threads. The order
+* of the calls is unspecified.
+*
+* The tree is cut at a fixed depth into subtrees of a few thousand nodes
+* each (plus the single nodes above the cut). Those units are handed out
+* with work stealing, so a lopsided tree still keeps the threads busy.
+* The cut only depends on the tree's size, never on threads.
+*/
+template<class Key, class Value, class Compare>
+template<typename F>
+void BinarySearchTree<Key, Value, Compare>::parallel_for_each(F f, unsigned threads) const
+{
+    parallelWalk(NULL, NULL, f, threads);
+}
+
+/**
+* Calls f(item) for every item with lo <= key < hi, from up to threads
+* threads. Subtrees wholly outside the range are skipped while cutting.
+*/
+template<class Key, class Value, class Compare>
+template<typename F>
+void BinarySearchTree<Key, Value, Compare>::parallel_for_each_range(const Key& lo, const Key& hi, F f,
+    unsigned threads) const
+{
+    parallelWalk(&lo, &hi, f, threads);
+}
+
+/**
+* Folds every item into combine(...combine(combine(identity, map(a)),
+* map(b))..., map(z)) in key order, computed from up to threads threads.
+* Each unit is folded on its own from identity and the unit results are
+* then combined in key order, so for any associative combine (and an
+* identity that really is one) the result equals the serial fold. As the
+* units do not depend on threads, the result is also bit-for-bit the
+* same for every thread count, floating-point sums included.
+*/
+template<class Key, class Value, class Compare>
+template<typename T, typename Map, typename Combine>
+T BinarySearchTree<Key, Value, Compare>::parallel_reduce(const T& identity, Map map, Combine combine,
+    unsigned threads) const
+{
+    return parallelReduce(NULL, NULL, identity, map, combine, threads);
+}
+
+/**
+* parallel_reduce over the items with lo <= key < hi.
+*/
+template<class Key, class Value, class Compare>
+template<typename T, typename Map, typename Combine>
+T BinarySearchTree<Key, Value, Compare>::parallel_reduce_range(const Key& lo, const Key& hi, const T& identity,
+    Map map, Combine combine, unsigned threads) const
+{
+    return parallelReduce(&lo, &hi, identity, map, combine, threads);
+}
+
+/**
+* Appends the units covering the subtree under n, in key order: whole
+* subtrees at cutDepth, single nodes above it. Every key under n lies
+* strictly between *lower and *upper (where set), which lets subtrees
+* outside [lo, hi) be dropped without visiting them.
+*/
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::splitWork(Node<Key, Value>* n, int depth, int cutDepth,
+    const Key* lower, const Key* upper, const Key* lo, const Key* hi, std::vector<WorkUnit>& units) const
+{
+    if (n == NULL) {
+        return;
+    }
+    if ((lo != NULL && upper != NULL && !comp_(*lo, *upper)) ||
+        (hi != NULL && lower != NULL && !comp_(*lower, *hi))) {
+        return;
+    }
+    if (depth >= cutDepth) {
+        WorkUnit unit = { n, true };
+        units.push_back(unit);
+        return;
+    }
+    splitWork(n->getLeft(), depth + 1, cutDepth, lower, &n->getKey(), lo, hi, units);
+    WorkUnit unit = { n, false };
+    units.push_back(unit);
+    splitWork(n->getRight(), depth + 1, cutDepth, &n->getKey(), upper, lo, hi, units);
+}
+
+template<class Key, class Value, class Compare>
+template<typename F>
+void BinarySearchTree<Key, Value, Compare>::runWork(const WorkUnit& unit, const Key* lo, const Key* hi, F& f) const
+{
+    if (unit.whole) {
+        walkInOrder(unit.node, lo, hi, f);
+        return;
+    }
+    Node<Key, Value>* n = unit.node;
+    if (n->isTombstone() || (lo != NULL && comp_(n->getKey(), *lo)) || (hi != NULL && !comp_(n->getKey(), *hi))) {
+        return;
+    }
+    f(n->getItem());
+}
+
+/**
+* Cuts the tree into units of about grain nodes, assuming it is roughly
+* balanced; an unbalanced tree just gives unevenly sized units. The cut
+* is shallow (log2(size / grain) levels), so splitWork's recursion is too.
+*/
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::planWork(const Key* lo, const Key* hi, std::vector<WorkUnit>& units) const
+{
+    const size_t grain = 1 << 12;
+    int cutDepth = 0;
+    while ((size_ >> cutDepth) > grain) {
+        ++cutDepth;
+    }
+    splitWork(root_, 0, cutDepth, NULL, NULL, lo, hi, units);
+}
+
+template<class Key, class Value, class Compare>
+template<typename F>
+void BinarySearchTree<Key, Value, Compare>::parallelWalk(const Key* lo, const Key* hi, F& f, unsigned threads) const
+{
+    std::vector<WorkUnit> units;
+    planWork(lo, hi, units);
+    auto always = [&f](std::pair<const Key, Value>& item) {
+        f(item);
+        return true;
+    };
+    parallelForIndex(units.size(), [&](size_t i) {
+        auto each = always;
+        runWork(units[i], lo, hi, each);
+    }, threads);
+}
+
+template<class Key, class Value, class Compare>
+template<typename T, typename Map, typename Combine>
+T BinarySearchTree<Key, Value, Compare>::parallelReduce(const Key* lo, const Key* hi, const T& identity, Map& map,
+    Combine& combine, unsigned threads) const
+{
+    // one slot per unit (not a std::vector<T>, which for bool would pack
+    // the slots into shared words)
+    struct Slot
+    {
+        T value;
+    };
+    std::vector<WorkUnit> units;
+    planWork(lo, hi, units);
+    std::vector<Slot> partial(units.size(), Slot{ identity });
+    parallelForIndex(units.size(), [&](size_t i) {
+        T acc = identity;
+        auto fold = [&acc, &map, &combine](std::pair<const Key, Value>& item) {
+            acc = combine(acc, map(item));
+            return true;
+        };
+        runWork(units[i], lo, hi, fold);
+        partial[i].value = acc;
+    }, threads);
+
+    T result = identity;
+    for (size_t i = 0; i < partial.size(); ++i) {
+        result = combine(result, partial[i].value);
+    }
+    return result;
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Compare>
+Value& BinarySearchTree<Key, Value, Compare>::operator[](const Key& key)
+{
+    Node<Key, Value> *curr = cachedFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+template<class Key, class Value, class Compare>
+Value const & BinarySearchTree<Key, Value, Compare>::operator[](const Key& key) const
+{
+    Node<Key, Value> *curr = cachedFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+/**
+* An insert method to insert into a Binary Search Tree.
+* The tree will not remain balanced when inserting.
+* Recall: If key is already in the tree, you should 
+* overwrite the current value with the updated value.
+*/
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::insert(const std::pair<const Key, Value> &keyValuePair)
+{
+    // walk down once, either overwriting the matching node
+    // or hanging a new leaf off the last node visited
+    const Key& key = keyValuePair.first;
+    const KeyPrefix prefix = probePrefix(key);
+
+    Node<Key, Value> *parent = nullptr;
+    Node<Key, Value> *traversalNode = root_;
+    int cmp = 0;
+
+    while (traversalNode) {
+        cmp = compareToNode(key, prefix, traversalNode);
+        if (cmp == 0) {
+            traversalNode->setValue(keyValuePair.second);
+            return;
+        }
+        parent = traversalNode;
+        traversalNode = (cmp < 0) ? traversalNode->getLeft() : traversalNode->getRight();
+    }
+
+    linkLeaf(keyValuePair, parent, cmp);
+}
+
+/**
+* Gives an existing node a new value. Trees with lazy removal or
+* augmented nodes override this to revive tombstones and refresh
+* summaries.
+*/
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::overwriteNode(Node<Key, Value>* n, const Value& value)
+{
+    n->setValue(value);
+}
+
+/**
+* Hangs a new node for keyValuePair below parent (or at the root if
+* parent is NULL), on the side given by cmp, and returns it. Balanced
+* trees override this to rebalance after linking.
+*/
+template<class Key, class Value, class Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::linkLeaf(const std::pair<const Key, Value>& keyValuePair,
+    Node<Key, Value>* parent, int cmp)
+{
+    Node<Key, Value> *newNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, parent);
+    ++size_;
+    if (!parent) {
+        root_ = newNode;
+    } else if (cmp < 0) {
+        parent->setLeft(newNode);
+    } else {
+        parent->setRight(newNode);
+    }
+    noteLinked(newNode);
+    return newNode;
+}
+
+
+
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::DestroyRecursive(Node<Key,Value> * node)
+{
+    if (node)
+    {
+        DestroyRecursive(node->getLeft());
+        DestroyRecursive(node->getRight());
+        delete node;
+    }
+}
+/*
+template<class Key, class Value>
+Node<Key,Value>* insertRecursive(Node<Key,Value> *r, Node<Key,Value> *new_node)
+{
+    if(r==NULL)
+    {
+        r=new_node;
+        return r;
+    }
+
+    if(new_node->getKey() < r->getKey())
+    {
+        r->setLeft( insertRecursive(r->getLeft(),new_node));
+    }
+    else if (new_node->getKey() > r->getKey())
+    {
+        r->setRight( insertRecursive(r->getRight(),new_node));
+    }
+    else
+    {
+        return r;
+    }
+    return r;
+}
+*/
+
+/**
+* A remove method to remove a specific key from a Binary Search Tree.
+* Recall: The writeup specifies that if a node has 2 children you
+* should swap with the predecessor and then remove.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::remove(const Key& key) {
+    Node<Key, Value> *searchedNode = internalFind(key);
+
+    if (!searchedNode) {
+        return;
+    }
+    removeNode(searchedNode);
+}
+
+/**
+* Removes a live node that is linked into this tree. Trees that
+* rebalance on removal override this rather than remove, which only
+* finds the node.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::removeNode(Node<Key, Value>* searchedNode)
+{
+    //If the searched node has 2 children swap with its predecessor
+    //so that it has at most one child, then promote that child
+    if((searchedNode->getRight()!= nullptr) && (searchedNode->getLeft()!= nullptr)){
+        nodeSwap(searchedNode,predecessor(searchedNode));
+    }
+    noteUnlinking(searchedNode);
+
+    Node<Key, Value> *child = searchedNode->getLeft();
+    if(child == nullptr){
+        child = searchedNode->getRight();
+    }
+    Node<Key, Value> *parent = searchedNode->getParent();
+    if(child != nullptr){
+        child->setParent(parent);
+    }
+
+    //root node
+    if(parent == nullptr){
+        root_ = child;
+    }
+    else if(searchedNode == parent->getLeft()){
+        parent->setLeft(child);
+    }
+    else{
+        parent->setRight(child);
+    }
+    forgetNode(searchedNode);
+    delete searchedNode;
+    --size_;
+}
+
+/**
+* Unlinks and frees n at once. The same as removeNode except in trees
+* that remove lazily, where n (live or a tombstone) must still be
+* unlinked rather than marked.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::eraseNode(Node<Key, Value>* n)
+{
+    removeNode(n);
+}
+
+template<class Key, class Value, class Compare>
+Node<Key, Value>*
+BinarySearchTree<Key, Value, Compare>::predecessor(Node<Key, Value>* current)
+{
+    if(current== nullptr)
+        return nullptr;
+    // The max value within the left subtree will be the predecessor
+    if (current->getLeft()!= nullptr){
+        Node<Key, Value>* tmp= current->getLeft();
+        while (tmp->getRight())
+            tmp=tmp->getRight();
+        return tmp;
+    }
+    // Otherwise it is the first ancestor we reach from its right side
+    Node<Key, Value>* parent = current->getParent();
+    while (parent != nullptr && current == parent->getLeft()) {
+        current = parent;
+        parent = parent->getParent();
+    }
+    return parent;
+}
+
+template<class Key, class Value, class Compare>
+Node<Key, Value>*
+BinarySearchTree<Key, Value, Compare>::successor(Node<Key, Value>* current)
+{
+    if(current== nullptr)
+        return nullptr;
+    // The min value within the right subtree will be the successor
+    if (current->getRight()!= nullptr){
+        Node<Key, Value>* tmp= current->getRight();
+        while (tmp->getLeft())
+            tmp=tmp->getLeft();
+        return tmp;
+    }
+    // Otherwise it is the first ancestor we reach from its left side
+    Node<Key, Value>* parent = current->getParent();
+    while (parent != nullptr && current == parent->getRight()) {
+        current = parent;
+        parent = parent->getParent();
+    }
+    return parent;
+}
+
+/**
+* Returns current, or the first node after it in order
+* that is not a tombstone
+*/
+template<class Key, class Value, class Compare>
+Node<Key, Value>*
+BinarySearchTree<Key, Value, Compare>::skipTombstones(Node<Key, Value>* current)
+{
+    while (current != nullptr && current->isTombstone()) {
+        current = successor(current);
+    }
+    return current;
+}
+
+/**
+* Like skipTombstones, walking toward smaller keys.
+*/
+template<class Key, class Value, class Compare>
+Node<Key, Value>*
+BinarySearchTree<Key, Value, Compare>::skipTombstonesBack(Node<Key, Value>* current)
+{
+    while (current != nullptr && current->isTombstone()) {
+        current = predecessor(current);
+    }
+    return current;
+}
+
+
+/**
+* A method to remove all contents of the tree and
+* reset the values in the tree for use again.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::clear()
+{
+    //
+    Node<Key,Value> *node = root_;
+    if(node) {
+        DestroyRecursive(root_->getRight());
+        DestroyRecursive(root_->getLeft());
+    }
+    root_ = nullptr;
+    leftmost_ = nullptr;
+    rightmost_ = nullptr;
+    size_ = 0;
+    delete node;
+    forgetAllNodes();
+    return;
+}
+
+
+/**
+* Helper function to find a node with given key, k and
+* return a pointer to it or NULL if no item with that key
+* exists
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::internalFind(const K& key) const
+{
+    const KeyPrefix prefix = probePrefix(key);
+    Node<Key, Value> *curr = root_;
+    while(curr) {
+        int cmp = compareToNode(key, prefix, curr);
+        if(cmp < 0){
+            curr = curr->getLeft();
+        }
+        else if(cmp > 0){
+            curr = curr->getRight();
+        }
         else{
+            return curr->isTombstone() ? NULL : curr;
+        }
+    }
+    return NULL;
+}
+
+/**
+* Index of the cache set for key. std::hash is often the identity on
+* integers, so it is spread with a multiplicative hash first.
+*/
+template<typename Key, typename Value, typename Compare>
+size_t BinarySearchTree<Key, Value, Compare>::hotCacheSet(const Key& key) const
+{
+    if constexpr (std::is_default_constructible<std::hash<Key> >::value) {
+        uint64_t h = uint64_t(std::hash<Key>()(key)) * 0x9E3779B97F4A7C15ULL;
+        return hotCacheBits_ == 0 ? 0 : size_t(h >> (64 - hotCacheBits_));
+    }
+    else {
+        return 0;
+    }
+}
+
+/**
+* internalFind through the hot cache, if there is one. A node is only
+* ever cached in the set of its own key, so forgetNode can find it, and
+* every cached node is linked into the tree.
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::cachedFind(const Key& key) const
+{
+    if (hotCache_.empty()) {
+        return internalFind(key);
+    }
+    Node<Key, Value>** set = &hotCache_[2 * hotCacheSet(key)];
+    for (int way = 0; way < 2; ++way) {
+        Node<Key, Value>* n = set[way];
+        if (n != NULL && !comp_(key, n->getKey()) && !comp_(n->getKey(), key)) {
+            ++hotHits_;
+            if (way == 1) {
+                std::swap(set[0], set[1]);
+            }
+            return n->isTombstone() ? NULL : n;
+        }
+    }
+    ++hotMisses_;
+    Node<Key, Value>* n = internalFind(key);
+    if (n != NULL) {
+        set = &hotCache_[2 * hotCacheSet(n->getKey())];
+        if (set[0] != n) {
+            set[1] = set[0];
+            set[0] = n;
+        }
+    }
+    return n;
+}
+
+/**
+* Drops n from the hot cache and makes every finger stale. Must be
+* called before n is freed or detached from the tree.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::forgetNode(Node<Key, Value>* n)
+{
+    ++fingerEpoch_;
+    if (hotCache_.empty()) {
+        return;
+    }
+    Node<Key, Value>** set = &hotCache_[2 * hotCacheSet(n->getKey())];
+    if (set[0] == n) {
+        set[0] = set[1];
+        set[1] = NULL;
+    }
+    else if (set[1] == n) {
+        set[1] = NULL;
+    }
+}
+
+/**
+* Empties the hot cache and makes every finger stale, for operations
+* that free or hand off many nodes at once.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::forgetAllNodes()
+{
+    std::fill(hotCache_.begin(), hotCache_.end(), (Node<Key, Value>*)NULL);
+    ++fingerEpoch_;
+}
+
+/**
+* Keeps leftmost_ and rightmost_ current after n was linked in as a new
+* leaf: it is the first node exactly when it hangs to the left of the
+* old first node (or the tree was empty), and likewise for the last.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::noteLinked(Node<Key, Value>* n)
+{
+    Node<Key, Value>* parent = n->getParent();
+    if (leftmost_ == NULL || (parent == leftmost_ && parent->getLeft() == n)) {
+        leftmost_ = n;
+    }
+    if (rightmost_ == NULL || (parent == rightmost_ && parent->getRight() == n)) {
+        rightmost_ = n;
+    }
+}
+
+/**
+* Moves leftmost_ and rightmost_ off n, which is about to be unlinked.
+* n must have at most one child, so its neighbour in key order is its
+* child's subtree or its parent; in an AVL or red-black tree that is at
+* most one step away.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::noteUnlinking(Node<Key, Value>* n)
+{
+    if (n == leftmost_) {
+        leftmost_ = successor(n);
+    }
+    if (n == rightmost_) {
+        rightmost_ = predecessor(n);
+    }
+}
+
+/**
+* Helper function returning the node with the smallest key that is
+* not less than the given key, or NULL if every key is less
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::internalLowerBound(const K& key) const
+{
+    const KeyPrefix prefix = probePrefix(key);
+    Node<Key, Value> *curr = root_;
+    Node<Key, Value> *result = NULL;
+    while(curr) {
+        int cmp = compareToNode(key, prefix, curr);
+        if(cmp < 0){
+            result = curr;
+            curr = curr->getLeft();
+        }
+        else if(cmp > 0){
             curr = curr->getRight();
         }
+        else{
+            return skipTombstones(curr);
+        }
     }
-    return curr;
-     */
+    return skipTombstones(result);
 }
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::recursiveFind(Node<Key,Value>*node,const Key& key) const
+
+/**
+* Computes the cached prefix of a search key once per descent,
+* or 0 when prefixes are not in use for this tree or key type.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+typename BinarySearchTree<Key, Value, Compare>::KeyPrefix
+BinarySearchTree<Key, Value, Compare>::probePrefix(const K& key) const
 {
-    // TODO
-    if(node== nullptr|| node->getKey()==key)
-        return node;
-    else if (key<node->getKey() )
-        return recursiveFind(node->getLeft(), key);
-    else
-        return recursiveFind(node->getRight(), key);
+    if constexpr (usesKeyPrefix && std::is_convertible<const K&, std::string_view>::value) {
+        return KeyPrefixTraits<Key>::make(std::string_view(key));
+    }
+    else {
+        return 0;
+    }
+}
+
+/**
+* Three-way comparison of a search key against a node's key.  Cached
+* prefixes settle most comparisons without touching the node's key;
+* on a tie only the bytes past the prefix are compared.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+int BinarySearchTree<Key, Value, Compare>::compareToNode(const K& key, KeyPrefix prefix, const Node<Key,Value>* node) const
+{
+    if constexpr (usesKeyPrefix && std::is_convertible<const K&, std::string_view>::value) {
+        KeyPrefix nodePrefix = node->getKeyPrefix();
+        if(prefix != nodePrefix) {
+            return prefix < nodePrefix ? -1 : 1;
+        }
+        std::string_view lhs(key);
+        std::string_view rhs(node->getKey());
+        size_t skip = std::min(std::min(lhs.size(), rhs.size()), sizeof(KeyPrefix));
+        return lhs.substr(skip).compare(rhs.substr(skip));
+    }
+    else {
+        return threeWayCompare<Key>(comp_, key, node->getKey());
+    }
 }
 
 /**
  * Return true iff the BST is balanced.
  */
 /**
- * Return true iff the BST is balanced.
+ * Return true iff the BST is balanced. Heights are computed post-order
+ * on this thread with an explicit stack, stopping at the first node
+ * whose subtrees differ by more than one; unlike shape_stats, nothing
+ * else is measured, so this stays cheap enough to call in loops.
  */
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::isBalanced() const
+template<typename Key, typename Value, typename Compare>
+bool BinarySearchTree<Key, Value, Compare>::isBalanced() const
 {
-    // TODO
-    //Check the difference in right and left subtrees recursively using the heignt function
-    return height(root_)!=-1;
+    struct Frame
+    {
+        Node<Key, Value>* node;
+        int leftHeight;
+        int rightHeight;
+        int state;      // 0 new, 1 left child done, 2 right child done
+    };
+    if (root_ == NULL) {
+        return true;
+    }
+    std::vector<Frame> stack;
+    Frame first = { root_, 0, 0, 0 };
+    stack.push_back(first);
+    while (!stack.empty()) {
+        Frame& f = stack.back();
+        if (f.state == 0) {
+            f.state = 1;
+            if (f.node->getLeft() != NULL) {
+                Frame child = { f.node->getLeft(), 0, 0, 0 };
+                stack.push_back(child);
+                continue;
+            }
+        }
+        if (f.state == 1) {
+            f.state = 2;
+            if (f.node->getRight() != NULL) {
+                Frame child = { f.node->getRight(), 0, 0, 0 };
+                stack.push_back(child);
+                continue;
+            }
+        }
+        if (std::abs(f.leftHeight - f.rightHeight) > 1) {
+            return false;
+        }
+        int height = 1 + std::max(f.leftHeight, f.rightHeight);
+        stack.pop_back();
+        if (!stack.empty()) {
+            if (stack.back().state == 1) {
+                stack.back().leftHeight = height;
+            }
+            else {
+                stack.back().rightHeight = height;
+            }
+        }
+    }
+    return true;
+}
+/**
+* Checks ordering, parent links and the tree's own invariants (see
+* checkNode) over the whole tree, and that size() matches the number
+* of live nodes. Subtrees are checked on up to threads threads. On
+* failure, a description of the first problem found is stored in
+* *error when error is not NULL.
+*/
+template<typename Key, typename Value, typename Compare>
+bool BinarySearchTree<Key, Value, Compare>::validate(std::string* error, unsigned threads) const
+{
+    ShapeStats stats;
+    std::string problem;
+    inspect(stats, problem, threads);
+    if (error != NULL) {
+        *error = problem;
+    }
+    return problem.empty();
+}
+
+/**
+* Measures the tree's height, depth histogram and average search depth,
+* splitting the work across up to threads threads.
+*/
+template<typename Key, typename Value, typename Compare>
+ShapeStats BinarySearchTree<Key, Value, Compare>::shape_stats(unsigned threads) const
+{
+    ShapeStats stats;
+    std::string problem;
+    inspect(stats, problem, threads);
+    return stats;
+}
 
+/**
+* Hook for the invariants of a balanced or augmented tree, called once
+* per node with the heights of its subtrees. Nothing to check in a
+* plain BST.
+*/
+template<typename Key, typename Value, typename Compare>
+bool BinarySearchTree<Key, Value, Compare>::checkNode(const Node<Key, Value>* n, int leftHeight, int rightHeight) const
+{
+    return true;
 }
-template<typename Key, typename Value>
-int height(Node<Key, Value>* node)
+
+/**
+* Walks the subtree under check.root post-order with an explicit stack,
+* so that even a degenerate tree cannot overflow the call stack.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::checkSubtree(SubtreeCheck& check) const
+{
+    struct Frame
+    {
+        Node<Key, Value>* node;
+        int depth;
+        const Key* lo;
+        const Key* hi;
+        int leftHeight;
+        int rightHeight;
+        int state;      // 0 new, 1 left child pending, 2 right child pending
+    };
+    check.height = 0;
+    check.nodes = 0;
+    check.liveNodes = 0;
+    check.depthSum = 0;
+    check.heightBalanced = true;
+    if (check.root == NULL) {
+        return;
+    }
+
+    std::vector<Frame> stack;
+    Frame first = { check.root, check.depth, check.lo, check.hi, 0, 0, 0 };
+    stack.push_back(first);
+    while (!stack.empty()) {
+        Frame& f = stack.back();
+        Node<Key, Value>* n = f.node;
+        if (f.state == 0) {
+            ++check.nodes;
+            if (check.depthHistogram.size() <= size_t(f.depth)) {
+                check.depthHistogram.resize(f.depth + 1, 0);
+            }
+            ++check.depthHistogram[f.depth];
+            if (!n->isTombstone()) {
+                ++check.liveNodes;
+                check.depthSum += f.depth;
+            }
+            if (check.error.empty()) {
+                if ((f.lo != NULL && !comp_(*f.lo, n->getKey())) ||
+                    (f.hi != NULL && !comp_(n->getKey(), *f.hi))) {
+                    check.error = "key out of order at depth " + std::to_string(f.depth);
+                }
+                else if ((n->getLeft() != NULL && n->getLeft()->getParent() != n) ||
+                         (n->getRight() != NULL && n->getRight()->getParent() != n)) {
+                    check.error = "child with wrong parent link at depth " + std::to_string(f.depth + 1);
+                }
+            }
+            f.state = 1;
+            if (n->getLeft() != NULL) {
+                Frame child = { n->getLeft(), f.depth + 1, f.lo, &n->getKey(), 0, 0, 0 };
+                stack.push_back(child);
+                continue;
+            }
+        }
+        if (f.state == 1) {
+            f.state = 2;
+            if (n->getRight() != NULL) {
+                Frame child = { n->getRight(), f.depth + 1, &n->getKey(), f.hi, 0, 0, 0 };
+                stack.push_back(child);
+                continue;
+            }
+        }
+        int height = 1 + std::max(f.leftHeight, f.rightHeight);
+        if (std::abs(f.leftHeight - f.rightHeight) > 1) {
+            check.heightBalanced = false;
+        }
+        if (check.error.empty() && !checkNode(n, f.leftHeight, f.rightHeight)) {
+            check.error = "tree invariant broken at depth " + std::to_string(f.depth);
+        }
+        stack.pop_back();
+        if (stack.empty()) {
+            check.height = height;
+        }
+        else if (stack.back().state == 1) {
+            stack.back().leftHeight = height;
+        }
+        else {
+            stack.back().rightHeight = height;
+        }
+    }
+}
+
+/**
+* Visits the nodes above depth cutDepth recursively (there are fewer
+* than 2^cutDepth of them). With collect set, only appends each subtree
+* rooted at cutDepth to parts; otherwise checks the nodes above the cut,
+* taking the heights of the already checked subtrees from parts[next]
+* in the same order. Returns the height of the subtree under n.
+*/
+template<typename Key, typename Value, typename Compare>
+int BinarySearchTree<Key, Value, Compare>::checkTop(Node<Key, Value>* n, int depth, const Key* lo, const Key* hi,
+    int cutDepth, bool collect, std::vector<SubtreeCheck>& parts, size_t& next, SubtreeCheck& top) const
 {
-    // base case tree is empty
-    if (node == NULL)
+    if (n == NULL) {
+        return 0;
+    }
+    if (depth == cutDepth) {
+        if (collect) {
+            SubtreeCheck part;
+            part.root = n;
+            part.depth = depth;
+            part.lo = lo;
+            part.hi = hi;
+            parts.push_back(part);
+            return 0;
+        }
+        return parts[next++].height;
+    }
+    int leftHeight = checkTop(n->getLeft(), depth + 1, lo, &n->getKey(), cutDepth, collect, parts, next, top);
+    int rightHeight = checkTop(n->getRight(), depth + 1, &n->getKey(), hi, cutDepth, collect, parts, next, top);
+    if (collect) {
         return 0;
+    }
 
-    // If tree is not empty then
-    // height = 1 + max of left height
-    // and right height
-    int leftHeight = height(node->getLeft());
-    if (leftHeight== -1) return -1;
-    int rightHeight = height(node->getRight());
-    if (rightHeight== -1) return -1;
-    if (std::abs(leftHeight-rightHeight)>1) return -1;
-    return 1 + std::max (leftHeight,rightHeight);
+    ++top.nodes;
+    if (top.depthHistogram.size() <= size_t(depth)) {
+        top.depthHistogram.resize(depth + 1, 0);
+    }
+    ++top.depthHistogram[depth];
+    if (!n->isTombstone()) {
+        ++top.liveNodes;
+        top.depthSum += depth;
+    }
+    if (std::abs(leftHeight - rightHeight) > 1) {
+        top.heightBalanced = false;
+    }
+    if (top.error.empty()) {
+        if ((lo != NULL && !comp_(*lo, n->getKey())) || (hi != NULL && !comp_(n->getKey(), *hi))) {
+            top.error = "key out of order at depth " + std::to_string(depth);
+        }
+        else if ((n->getLeft() != NULL && n->getLeft()->getParent() != n) ||
+                 (n->getRight() != NULL && n->getRight()->getParent() != n)) {
+            top.error = "child with wrong parent link at depth " + std::to_string(depth + 1);
+        }
+        else if (!checkNode(n, leftHeight, rightHeight)) {
+            top.error = "tree invariant broken at depth " + std::to_string(depth);
+        }
+    }
+    return 1 + std::max(leftHeight, rightHeight);
 }
 
+/**
+* Shared by validate and shape_stats. The nodes above a cut depth chosen
+* to give a few subtrees per thread are collected first; the subtrees
+* are then checked in parallel, and finally the nodes above the cut are
+* checked on this thread using the subtree heights.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::inspect(ShapeStats& stats, std::string& error, unsigned threads) const
+{
+    if (threads == 0) {
+        threads = 1;
+    }
+    int cutDepth = 0;
+    while (threads > 1 && (size_t(1) << cutDepth) < 8 * size_t(threads)) {
+        ++cutDepth;
+    }
+
+    std::vector<SubtreeCheck> parts;
+    SubtreeCheck top;
+    size_t next = 0;
+    checkTop(root_, 0, NULL, NULL, cutDepth, true, parts, next, top);
+
+    std::atomic<size_t> claimed(0);
+    std::vector<std::thread> workers;
+    size_t workerCount = std::min<size_t>(threads, parts.size());
+    for (size_t t = 0; t < workerCount; ++t) {
+        workers.push_back(std::thread([this, &parts, &claimed]() {
+            for (size_t i = claimed++; i < parts.size(); i = claimed++) {
+                checkSubtree(parts[i]);
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
 
+    stats.height = checkTop(root_, 0, NULL, NULL, cutDepth, false, parts, next, top);
+
+    stats.nodes = top.nodes;
+    stats.liveNodes = top.liveNodes;
+    stats.heightBalanced = top.heightBalanced;
+    stats.depthHistogram = top.depthHistogram;
+    unsigned long long depthSum = top.depthSum;
+    error = top.error;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        const SubtreeCheck& part = parts[i];
+        stats.nodes += part.nodes;
+        stats.liveNodes += part.liveNodes;
+        stats.heightBalanced = stats.heightBalanced && part.heightBalanced;
+        depthSum += part.depthSum;
+        if (stats.depthHistogram.size() < part.depthHistogram.size()) {
+            stats.depthHistogram.resize(part.depthHistogram.size(), 0);
+        }
+        for (size_t d = part.depth; d < part.depthHistogram.size(); ++d) {
+            stats.depthHistogram[d] += part.depthHistogram[d];
+        }
+        if (error.empty()) {
+            error = part.error;
+        }
+    }
+    stats.averageSearchDepth = stats.liveNodes == 0 ? 0.0 : 1.0 + double(depthSum) / stats.liveNodes;
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
+    if (error.empty() && root_ != NULL && root_->getParent() != NULL) {
+        error = "root has a parent";
+    }
+    if (error.empty()) {
+        Node<Key, Value>* first = root_;
+        Node<Key, Value>* last = root_;
+        while (first != NULL && first->getLeft() != NULL) {
+            first = first->getLeft();
+        }
+        while (last != NULL && last->getRight() != NULL) {
+            last = last->getRight();
+        }
+        if (leftmost_ != first || rightmost_ != last) {
+            error = "cached leftmost or rightmost node is stale";
+        }
+    }
+    if (error.empty() && stats.liveNodes != size_) {
+        error = "size() is " + std::to_string(size_) + " but " +
+            std::to_string(stats.liveNodes) + " live nodes are linked";
+    }
+}
+
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
 {
     if((n1 == n2) || (n1 == NULL) || (n2 == NULL) ) {
         return;
     }
+    // callers swap to free one of the two next
+    forgetNode(n1);
+    forgetNode(n2);
     Node<Key, Value>* n1p = n1->getParent();
     Node<Key, Value>* n1r = n1->getRight();
     Node<Key, Value>* n1lt = n1->getLeft();
@@ -889,6 +2247,77 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
         this->root_ = n1;
     }
 
+    // the two nodes traded places, so the cached extremes trade too
+    if(leftmost_ == n1) leftmost_ = n2;
+    else if(leftmost_ == n2) leftmost_ = n1;
+    if(rightmost_ == n1) rightmost_ = n2;
+    else if(rightmost_ == n2) rightmost_ = n1;
+
+}
+
+/**
+* Rotates n down and to the left, promoting its right child.
+* Shared by the balanced trees built on top of this class.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::rotateLeft(Node<Key, Value>* n)
+{
+    Node<Key, Value>* y = n->getRight();
+    Node<Key, Value>* rootParent = n->getParent();
+    y->setParent(rootParent);
+
+    //set the root parent
+    if (rootParent == NULL) {
+        root_ = y;
+    }
+    else if (rootParent->getRight() == n){
+        rootParent->setRight(y);
+    }
+    else{
+        rootParent->setLeft(y);
+    }
+
+    //pointer shifts
+    Node<Key, Value>* c = y->getLeft();
+
+    y->setLeft(n);
+    n->setParent(y);
+    n->setRight(c);
+    if (c != NULL){
+        c->setParent(n);
+    }
+    ++rotations_;
+}
+
+/**
+* Rotates n down and to the right, promoting its left child.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::rotateRight(Node<Key, Value>* n)
+{
+    Node<Key, Value>* y = n->getLeft();
+    Node<Key, Value>* rootParent = n->getParent();
+    y->setParent(rootParent);
+
+    if (rootParent == NULL) {
+        root_ = y;
+    }
+    else if (rootParent->getRight() == n){
+        rootParent->setRight(y);
+    }
+    else{
+        rootParent->setLeft(y);
+    }
+
+    Node<Key, Value>* c = y->getRight();
+
+    y->setRight(n);
+    n->setParent(y);
+    n->setLeft(c);
+    if (c != NULL){
+        c->setParent(n);
+    }
+    ++rotations_;
 }
 
 /**
@@ -904,6 +2333,8 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
 
 // include print function (in its own file because it's fairly long)
 #include "print_bst.h"
+// and the DOT/JSON exporters
+#include "export_bst.h"
 
 /*
 ---------------------------------------------------
@@ -0,0 +1,475 @@
+
+#ifndef BUFFEREDBST_H
+#define BUFFEREDBST_H
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "avlbst.h"
+
+/**
+* An AVLTree with a small sorted write buffer in front of it, in the
+* style of an LSM tree's memtable. Inserts, overwrites and removes only
+* touch the buffer; when it fills up, its contents are handed to the
+* tree as one sorted AVLTree::apply_batch call. find and iteration see
+* the buffer and the tree merged, with buffered writes taking priority.
+*
+* Buffered items live in slots that are appended and never moved until
+* the next flush, so references returned by find and operator[] stay
+* valid until then; a separate index keeps the slots in key order.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class BufferedAVLTree
+{
+public:
+    explicit BufferedAVLTree(size_t bufferSize = 1024);
+    BufferedAVLTree(size_t bufferSize, const Compare& comp);
+    ~BufferedAVLTree();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void flush();
+    void clear();
+    size_t size() const;
+    bool empty() const;
+
+    void setBufferSize(size_t bufferSize);
+    size_t getBufferSize() const;
+    size_t getBufferedCount() const;
+    const AVLTree<Key, Value, Compare>& getTree() const;
+
+protected:
+    struct Slot
+    {
+        Slot(const Key& key, const Value& value, bool remove) :
+            item(key, value), remove(remove) { }
+        std::pair<const Key, Value> item;
+        bool remove;
+    };
+
+public:
+    /**
+    * Walks the buffer and the tree together in key order.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class BufferedAVLTree<Key, Value, Compare>;
+        iterator(const BufferedAVLTree<Key, Value, Compare>* owner,
+                 typename AVLTree<Key, Value, Compare>::iterator treeIt, size_t bufferPos);
+        bool onBuffer() const;
+        bool sameKey() const;
+        void settle();
+
+        const BufferedAVLTree<Key, Value, Compare>* owner_;
+        typename AVLTree<Key, Value, Compare>::iterator treeIt_;
+        size_t bufferPos_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    size_t count(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    size_t bufferLowerBound(const Key& key) const;
+    bool bufferHas(size_t pos, const Key& key) const;
+    void record(const Key& key, const Value& value, bool remove);
+    Slot& slotAt(size_t pos) const;
+
+    AVLTree<Key, Value, Compare> tree_;
+    Compare comp_;
+    size_t bufferSize_;
+    std::vector<Slot> slots_;       // in arrival order, never reallocated between flushes
+    std::vector<uint32_t> order_;   // slot indices in key order
+    size_t size_;                   // live items, buffered writes included
+};
+
+/*
+--------------------------------------------------------------
+Begin implementations for the BufferedAVLTree::iterator class.
+---------------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+BufferedAVLTree<Key, Value, Compare>::iterator::iterator() :
+    owner_(NULL), treeIt_(), bufferPos_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+BufferedAVLTree<Key, Value, Compare>::iterator::iterator(const BufferedAVLTree<Key, Value, Compare>* owner,
+    typename AVLTree<Key, Value, Compare>::iterator treeIt, size_t bufferPos) :
+    owner_(owner), treeIt_(treeIt), bufferPos_(bufferPos)
+{
+
+}
+
+/**
+* True when the current item comes from the buffer.
+*/
+template<class Key, class Value, class Compare>
+bool BufferedAVLTree<Key, Value, Compare>::iterator::onBuffer() const
+{
+    if (bufferPos_ >= owner_->order_.size()) {
+        return false;
+    }
+    return treeIt_ == owner_->tree_.end() ||
+           !owner_->comp_(treeIt_->first, owner_->slotAt(bufferPos_).item.first);
+}
+
+/**
+* True when the buffer and the tree are both positioned on the same key.
+*/
+template<class Key, class Value, class Compare>
+bool BufferedAVLTree<Key, Value, Compare>::iterator::sameKey() const
+{
+    if (bufferPos_ >= owner_->order_.size() || treeIt_ == owner_->tree_.end()) {
+        return false;
+    }
+    const Key& bufferKey = owner_->slotAt(bufferPos_).item.first;
+    return !owner_->comp_(treeIt_->first, bufferKey) && !owner_->comp_(bufferKey, treeIt_->first);
+}
+
+/**
+* Steps over buffered removes and the tree items they hide.
+*/
+template<class Key, class Value, class Compare>
+void BufferedAVLTree<Key, Value, Compare>::iterator::settle()
+{
+    while (onBuffer() && owner_->slotAt(bufferPos_).remove) {
+        if (sameKey()) {
+            ++treeIt_;
+        }
+        ++bufferPos_;
+    }
+}
+
+template<class Key, class Value, class Compare>
+std::pair<const Key,Value>&
+BufferedAVLTree<Key, Value, Compare>::iterator::operator*() const
+{
+    return onBuffer() ? owner_->slotAt(bufferPos_).item : *treeIt_;
+}
+
+template<class Key, class Value, class Compare>
+std::pair<const Key,Value>*
+BufferedAVLTree<Key, Value, Compare>::iterator::operator->() const
+{
+    return &(**this);
+}
+
+template<class Key, class Value, class Compare>
+bool BufferedAVLTree<Key, Value, Compare>::iterator::operator==(const iterator& rhs) const
+{
+    return treeIt_ == rhs.treeIt_ && bufferPos_ == rhs.bufferPos_;
+}
+
+template<class Key, class Value, class Compare>
+bool BufferedAVLTree<Key, Value, Compare>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+/**
+* Advances past the current key on whichever side(s) hold it.
+*/
+template<class Key, class Value, class Compare>
+typename BufferedAVLTree<Key, Value, Compare>::iterator&
+BufferedAVLTree<Key, Value, Compare>::iterator::operator++()
+{
+    if (onBuffer()) {
+        if (sameKey()) {
+            ++treeIt_;
+        }
+        ++bufferPos_;
+    }
+    else {
+        ++treeIt_;
+    }
+    settle();
+    return *this;
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the BufferedAVLTree::iterator class.
+-------------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+BufferedAVLTree<Key, Value, Compare>::BufferedAVLTree(size_t bufferSize) :
+    tree_(), comp_(), bufferSize_(bufferSize == 0 ? 1 : bufferSize), size_(0)
+{
+    slots_.reserve(bufferSize_);
+    order_.reserve(bufferSize_);
+}
+
+template<class Key, class Value, class Compare>
+BufferedAVLTree<Key, Value, Compare>::BufferedAVLTree(size_t bufferSize, const Compare& comp) :
+    tree_(comp), comp_(comp), bufferSize_(bufferSize == 0 ? 1 : bufferSize), size_(0)
+{
+    slots_.reserve(bufferSize_);
+    order_.reserve(bufferSize_);
+}
+
+template<class Key, class Value, class Compare>
+BufferedAVLTree<Key, Value, Compare>::~BufferedAVLTree()
+{
+
+}
+
+template<class Key, class Value, class Compare>
+typename BufferedAVLTree<Key, Value, Compare>::Slot&
+BufferedAVLTree<Key, Value, Compare>::slotAt(size_t pos) const
+{
+    return const_cast<Slot&>(slots_[order_[pos]]);
+}
+
+/**
+* Position in order_ of the first buffered key not less than key.
+*/
+template<class Key, class Value, class Compare>
+size_t BufferedAVLTree<Key, Value, Compare>::bufferLowerBound(const Key& key) const
+{
+    size_t lo = 0;
+    size_t hi = order_.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (comp_(slots_[order_[mid]].item.first, key)) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+template<class Key, class Value, class Compare>
+bool BufferedAVLTree<Key, Value, Compare>::bufferHas(size_t pos, const Key& key) const
+{
+    return pos < order_.size() && !comp_(key, slots_[order_[pos]].item.first);
+}
+
+/**
+* Records a write in the buffer, overwriting any earlier write to the
+* same key, and flushes first if a new slot is needed but none is free.
+* size_ follows along: a key's first buffered write is checked against
+* the tree once, later writes only against the previous one.
+*/
+template<class Key, class Value, class Compare>
+void BufferedAVLTree<Key, Value, Compare>::record(const Key& key, const Value& value, bool remove)
+{
+    size_t pos = bufferLowerBound(key);
+    if (bufferHas(pos, key)) {
+        Slot& slot = slotAt(pos);
+        if (slot.remove != remove) {
+            size_ = remove ? size_ - 1 : size_ + 1;
+        }
+        slot.item.second = value;
+        slot.remove = remove;
+        return;
+    }
+    if (slots_.size() >= bufferSize_) {
+        flush();
+        pos = 0;
+    }
+    bool inTree = tree_.count(key) > 0;
+    if (remove && inTree) {
+        --size_;
+    }
+    else if (!remove && !inTree) {
+        ++size_;
+    }
+    slots_.push_back(Slot(key, value, remove));
+    order_.insert(order_.begin() + pos, uint32_t(slots_.size() - 1));
+}
+
+/**
+* Buffers an insert or overwrite of the key.
+*/
+template<class Key, class Value, class Compare>
+void BufferedAVLTree<Key, Value, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    record(keyValuePair.first, keyValuePair.second, false);
+}
+
+/**
+* Buffers a removal of the key.
+*/
+template<class Key, class Value, class Compare>
+void BufferedAVLTree<Key, Value, Compare>::remove(const Key& key)
+{
+    record(key, Value(), true);
+}
+
+/**
+* Applies every buffered write to the tree as one sorted batch.
+*/
+template<class Key, class Value, class Compare>
+void BufferedAVLTree<Key, Value, Compare>::flush()
+{
+    if (order_.empty()) {
+        return;
+    }
+    std::vector<BatchOp<Key, Value> > ops;
+    ops.reserve(order_.size());
+    for (size_t i = 0; i < order_.size(); ++i) {
+        const Slot& slot = slots_[order_[i]];
+        if (slot.remove) {
+            ops.push_back(BatchOp<Key, Value>::erase(slot.item.first));
+        }
+        else {
+            ops.push_back(BatchOp<Key, Value>::upsert(slot.item.first, slot.item.second));
+        }
+    }
+    slots_.clear();
+    order_.clear();
+    tree_.apply_batch(std::move(ops));
+}
+
+template<class Key, class Value, class Compare>
+void BufferedAVLTree<Key, Value, Compare>::clear()
+{
+    slots_.clear();
+    order_.clear();
+    tree_.clear();
+    size_ = 0;
+}
+
+/**
+* Number of live items, buffered writes included.
+*/
+template<class Key, class Value, class Compare>
+size_t BufferedAVLTree<Key, Value, Compare>::size() const
+{
+    return size_;
+}
+
+template<class Key, class Value, class Compare>
+bool BufferedAVLTree<Key, Value, Compare>::empty() const
+{
+    return size_ == 0;
+}
+
+/**
+* Sets how many distinct keys the buffer holds before it is flushed.
+*/
+template<class Key, class Value, class Compare>
+void BufferedAVLTree<Key, Value, Compare>::setBufferSize(size_t bufferSize)
+{
+    flush();
+    bufferSize_ = bufferSize == 0 ? 1 : bufferSize;
+    // slots must not reallocate between flushes, see the class comment
+    std::vector<Slot>().swap(slots_);
+    slots_.reserve(bufferSize_);
+    order_.reserve(bufferSize_);
+}
+
+template<class Key, class Value, class Compare>
+size_t BufferedAVLTree<Key, Value, Compare>::getBufferSize() const
+{
+    return bufferSize_;
+}
+
+/**
+* Number of writes waiting in the buffer.
+*/
+template<class Key, class Value, class Compare>
+size_t BufferedAVLTree<Key, Value, Compare>::getBufferedCount() const
+{
+    return order_.size();
+}
+
+/**
+* The tree behind the buffer; it lacks any writes still buffered.
+*/
+template<class Key, class Value, class Compare>
+const AVLTree<Key, Value, Compare>& BufferedAVLTree<Key, Value, Compare>::getTree() const
+{
+    return tree_;
+}
+
+template<class Key, class Value, class Compare>
+typename BufferedAVLTree<Key, Value, Compare>::iterator
+BufferedAVLTree<Key, Value, Compare>::begin() const
+{
+    iterator it(this, tree_.begin(), 0);
+    it.settle();
+    return it;
+}
+
+template<class Key, class Value, class Compare>
+typename BufferedAVLTree<Key, Value, Compare>::iterator
+BufferedAVLTree<Key, Value, Compare>::end() const
+{
+    return iterator(this, tree_.end(), order_.size());
+}
+
+/**
+* Checks the buffer before the tree. The returned iterator can be
+* advanced; it continues through the merged contents.
+*/
+template<class Key, class Value, class Compare>
+typename BufferedAVLTree<Key, Value, Compare>::iterator
+BufferedAVLTree<Key, Value, Compare>::find(const Key& key) const
+{
+    size_t pos = bufferLowerBound(key);
+    if (bufferHas(pos, key)) {
+        if (slots_[order_[pos]].remove) {
+            return end();
+        }
+        return iterator(this, tree_.lower_bound(key), pos);
+    }
+    typename AVLTree<Key, Value, Compare>::iterator treeIt = tree_.find(key);
+    if (treeIt == tree_.end()) {
+        return end();
+    }
+    return iterator(this, treeIt, pos);
+}
+
+template<class Key, class Value, class Compare>
+size_t BufferedAVLTree<Key, Value, Compare>::count(const Key& key) const
+{
+    return find(key) != end() ? 1 : 0;
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Compare>
+Value& BufferedAVLTree<Key, Value, Compare>::operator[](const Key& key)
+{
+    iterator it = find(key);
+    if(it == end()) throw std::out_of_range("Invalid key");
+    return it->second;
+}
+
+template<class Key, class Value, class Compare>
+Value const & BufferedAVLTree<Key, Value, Compare>::operator[](const Key& key) const
+{
+    iterator it = find(key);
+    if(it == end()) throw std::out_of_range("Invalid key");
+    return it->second;
+}
+
+
+#endif
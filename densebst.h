@@ -0,0 +1,431 @@
+
+#ifndef DENSEBST_H
+#define DENSEBST_H
+
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "avlbst.h"
+
+/**
+* True for key types that DenseTable can index directly: integral types
+* (other than bool) with at most 2^16 values, ordered by std::less.
+*/
+template <class Key, class Compare>
+struct IsDenseKey : std::integral_constant<bool,
+    std::is_integral<Key>::value && !std::is_same<Key, bool>::value &&
+    sizeof(Key) <= 2 && std::is_same<Compare, std::less<Key> >::value>
+{
+};
+
+/**
+* An ordered map for small integral keys. Every possible key has a slot
+* in one array, indexed by the key's offset from its type's minimum, and
+* a bitmap marks the occupied slots. Lookups, inserts and removals are
+* one index computation; in-order iteration scans the bitmap a word at
+* a time, so the order matches std::less and AVLTree exactly.
+*
+* The array and bitmap are allocated on the first insert and kept until
+* the table is destroyed (2^16 slots for 16-bit keys, 256 for char).
+* The interface follows BinarySearchTree; use OrderedMap to get this
+* table or an AVLTree depending on the key type.
+*/
+template <class Key, class Value>
+class DenseTable
+{
+public:
+    typedef std::pair<const Key, Value> Item;
+    typedef typename std::make_unsigned<Key>::type Index;
+
+    static const size_t SLOTS = size_t(1) << (8 * sizeof(Key));
+    static const size_t WORDS = (SLOTS + 63) / 64;
+
+    /**
+    * Visits the occupied slots in key order.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        Item& operator*() const;
+        Item* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class DenseTable<Key, Value>;
+        iterator(const DenseTable* table, size_t slot);
+
+        const DenseTable* table_;
+        size_t slot_;   // SLOTS at the end
+    };
+
+    DenseTable();
+    DenseTable(const DenseTable& other);
+    DenseTable& operator=(const DenseTable& other);
+    ~DenseTable();
+
+    void insert(const Item& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool isBalanced() const;
+
+    bool empty() const;
+    size_t size() const;
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    size_t count(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+    template<typename F>
+    void for_each(F f) const;
+
+    MemoryUsage memory_usage() const;
+
+protected:
+    static size_t slotOf(const Key& key);
+    bool occupied(size_t slot) const;
+    size_t nextOccupied(size_t slot) const;
+    void allocate();
+
+    Item* slots_;   // NULL until the first insert
+    std::vector<uint64_t> bits_;
+    size_t size_;
+};
+
+/**
+* Selects the map for a key type at compile time: a DenseTable for small
+* integral keys (see IsDenseKey), an AVLTree for everything else.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+using OrderedMap = typename std::conditional<IsDenseKey<Key, Compare>::value,
+    DenseTable<Key, Value>, AVLTree<Key, Value, Compare> >::type;
+
+/*
+--------------------------------------------------------------
+Begin implementations for the DenseTable::iterator class.
+---------------------------------------------------------------
+*/
+
+template<class Key, class Value>
+DenseTable<Key, Value>::iterator::iterator() :
+    table_(NULL), slot_(SLOTS)
+{
+
+}
+
+template<class Key, class Value>
+DenseTable<Key, Value>::iterator::iterator(const DenseTable* table, size_t slot) :
+    table_(table), slot_(slot)
+{
+
+}
+
+template<class Key, class Value>
+typename DenseTable<Key, Value>::Item&
+DenseTable<Key, Value>::iterator::operator*() const
+{
+    return table_->slots_[slot_];
+}
+
+template<class Key, class Value>
+typename DenseTable<Key, Value>::Item*
+DenseTable<Key, Value>::iterator::operator->() const
+{
+    return &table_->slots_[slot_];
+}
+
+template<class Key, class Value>
+bool DenseTable<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return slot_ == rhs.slot_;
+}
+
+template<class Key, class Value>
+bool DenseTable<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+template<class Key, class Value>
+typename DenseTable<Key, Value>::iterator&
+DenseTable<Key, Value>::iterator::operator++()
+{
+    slot_ = table_->nextOccupied(slot_ + 1);
+    return *this;
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the DenseTable::iterator class.
+-------------------------------------------------------------
+*/
+
+template<class Key, class Value>
+DenseTable<Key, Value>::DenseTable() :
+    slots_(NULL), size_(0)
+{
+
+}
+
+template<class Key, class Value>
+DenseTable<Key, Value>::DenseTable(const DenseTable& other) :
+    slots_(NULL), size_(0)
+{
+    *this = other;
+}
+
+template<class Key, class Value>
+DenseTable<Key, Value>& DenseTable<Key, Value>::operator=(const DenseTable& other)
+{
+    if (this == &other) {
+        return *this;
+    }
+    clear();
+    for (iterator it = other.begin(); it != other.end(); ++it) {
+        insert(*it);
+    }
+    return *this;
+}
+
+template<class Key, class Value>
+DenseTable<Key, Value>::~DenseTable()
+{
+    clear();
+    ::operator delete(slots_);
+}
+
+/**
+* Maps a key to its slot so that slots are in key order: the sign bit
+* of a signed key is flipped, which moves the minimum to slot 0.
+*/
+template<class Key, class Value>
+size_t DenseTable<Key, Value>::slotOf(const Key& key)
+{
+    const Index signBit = std::is_signed<Key>::value ? Index(Index(1) << (8 * sizeof(Key) - 1)) : Index(0);
+    return size_t(Index(Index(key) ^ signBit));
+}
+
+template<class Key, class Value>
+bool DenseTable<Key, Value>::occupied(size_t slot) const
+{
+    return (bits_[slot / 64] >> (slot % 64)) & 1;
+}
+
+/**
+* Returns the first occupied slot at or after slot, or SLOTS.
+*/
+template<class Key, class Value>
+size_t DenseTable<Key, Value>::nextOccupied(size_t slot) const
+{
+    if (slot >= SLOTS || size_ == 0) {
+        return SLOTS;
+    }
+    size_t w = slot / 64;
+    uint64_t word = bits_[w] & (~uint64_t(0) << (slot % 64));
+    while (word == 0) {
+        if (++w == WORDS) {
+            return SLOTS;
+        }
+        word = bits_[w];
+    }
+#if defined(__GNUC__)
+    return w * 64 + size_t(__builtin_ctzll(word));
+#else
+    size_t bit = 0;
+    while (((word >> bit) & 1) == 0) {
+        ++bit;
+    }
+    return w * 64 + bit;
+#endif
+}
+
+template<class Key, class Value>
+void DenseTable<Key, Value>::allocate()
+{
+    slots_ = static_cast<Item*>(::operator new(SLOTS * sizeof(Item)));
+    bits_.assign(WORDS, 0);
+}
+
+/**
+* Inserts the pair, overwriting the value if the key is already present.
+*/
+template<class Key, class Value>
+void DenseTable<Key, Value>::insert(const Item& keyValuePair)
+{
+    if (slots_ == NULL) {
+        allocate();
+    }
+    size_t slot = slotOf(keyValuePair.first);
+    if (occupied(slot)) {
+        slots_[slot].second = keyValuePair.second;
+        return;
+    }
+    new (slots_ + slot) Item(keyValuePair);
+    bits_[slot / 64] |= uint64_t(1) << (slot % 64);
+    ++size_;
+}
+
+template<class Key, class Value>
+void DenseTable<Key, Value>::remove(const Key& key)
+{
+    size_t slot = slotOf(key);
+    if (size_ == 0 || !occupied(slot)) {
+        return;
+    }
+    slots_[slot].~Item();
+    bits_[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    --size_;
+}
+
+/**
+* Destroys every item; the storage stays allocated for reuse.
+*/
+template<class Key, class Value>
+void DenseTable<Key, Value>::clear()
+{
+    for (size_t slot = nextOccupied(0); slot != SLOTS; slot = nextOccupied(slot + 1)) {
+        slots_[slot].~Item();
+    }
+    bits_.assign(bits_.size(), 0);
+    size_ = 0;
+}
+
+/**
+* A table has no shape, so it is always balanced.
+*/
+template<class Key, class Value>
+bool DenseTable<Key, Value>::isBalanced() const
+{
+    return true;
+}
+
+template<class Key, class Value>
+bool DenseTable<Key, Value>::empty() const
+{
+    return size_ == 0;
+}
+
+template<class Key, class Value>
+size_t DenseTable<Key, Value>::size() const
+{
+    return size_;
+}
+
+template<class Key, class Value>
+typename DenseTable<Key, Value>::iterator
+DenseTable<Key, Value>::begin() const
+{
+    return iterator(this, nextOccupied(0));
+}
+
+template<class Key, class Value>
+typename DenseTable<Key, Value>::iterator
+DenseTable<Key, Value>::end() const
+{
+    return iterator(this, SLOTS);
+}
+
+template<class Key, class Value>
+typename DenseTable<Key, Value>::iterator
+DenseTable<Key, Value>::find(const Key& key) const
+{
+    size_t slot = slotOf(key);
+    if (size_ == 0 || !occupied(slot)) {
+        return end();
+    }
+    return iterator(this, slot);
+}
+
+template<class Key, class Value>
+size_t DenseTable<Key, Value>::count(const Key& key) const
+{
+    return (size_ != 0 && occupied(slotOf(key))) ? 1 : 0;
+}
+
+/**
+* Returns an iterator to the first key not less than key, or end().
+*/
+template<class Key, class Value>
+typename DenseTable<Key, Value>::iterator
+DenseTable<Key, Value>::lower_bound(const Key& key) const
+{
+    return iterator(this, nextOccupied(slotOf(key)));
+}
+
+template<class Key, class Value>
+Value& DenseTable<Key, Value>::operator[](const Key& key)
+{
+    size_t slot = slotOf(key);
+    if (size_ == 0 || !occupied(slot)) throw std::out_of_range("Invalid key");
+    return slots_[slot].second;
+}
+
+template<class Key, class Value>
+Value const & DenseTable<Key, Value>::operator[](const Key& key) const
+{
+    size_t slot = slotOf(key);
+    if (size_ == 0 || !occupied(slot)) throw std::out_of_range("Invalid key");
+    return slots_[slot].second;
+}
+
+/**
+* Reports the table like BinarySearchTree::memory_usage does, with each
+* slot counted as a node: the whole slot array once allocated, of which
+* itemBytes is in use, and the bitmap under otherBytes.
+*/
+template<class Key, class Value>
+MemoryUsage DenseTable<Key, Value>::memory_usage() const
+{
+    MemoryUsage usage;
+    size_t arrayBytes = slots_ == NULL ? 0 : SLOTS * sizeof(Item);
+    usage.nodes = size_;
+    usage.nodeBytes = arrayBytes;
+    usage.itemBytes = size_ * sizeof(Item);
+    usage.heapBytes = 0;
+    if (HeapUsageTraits<Value>::enabled) {
+        for_each([&usage](const Item& item) { usage.heapBytes += HeapUsageTraits<Value>::bytes(item.second); });
+    }
+    usage.slackBytes = slots_ == NULL ? 0 : allocationBytes(arrayBytes) - arrayBytes;
+    usage.otherBytes = bits_.capacity() * sizeof(uint64_t);
+    return usage;
+}
+
+/**
+* Calls f(item) for every item in key order, a bitmap word at a time.
+*/
+template<class Key, class Value>
+template<typename F>
+void DenseTable<Key, Value>::for_each(F f) const
+{
+    for (size_t w = 0; w < bits_.size(); ++w) {
+        uint64_t word = bits_[w];
+        while (word != 0) {
+#if defined(__GNUC__)
+            size_t bit = size_t(__builtin_ctzll(word));
+#else
+            size_t bit = 0;
+            while (((word >> bit) & 1) == 0) {
+                ++bit;
+            }
+#endif
+            word &= word - 1;
+            f(slots_[w * 64 + bit]);
+        }
+    }
+}
+
+#endif
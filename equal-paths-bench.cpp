@@ -0,0 +1,160 @@
+#include <iostream>
+#include <cstdio>
+#include <vector>
+#include <random>
+#include "equal-paths.h"
+#include "level-order.h"
+#include "bench_util.h"
+
+using namespace std;
+
+// Benchmark for equalPaths on large generated trees, on the linked
+// nodes and on their level-order encoding.
+// usage: equal-paths-bench [n]   (default 10000000 nodes per tree)
+
+// Perfect tree with the largest 2^k - 1 <= n nodes, allocated level by
+// level. Every leaf is at the same depth, so the check visits every node.
+static Node* makePerfect(size_t n, size_t& nodes)
+{
+    Node* root = new Node(0);
+    vector<Node*> level(1, root);
+    vector<Node*> next;
+    nodes = 1;
+    while(nodes + 2 * level.size() <= n) {
+        next.clear();
+        for(size_t i = 0; i < level.size(); ++i) {
+            level[i]->left = new Node(int(nodes++));
+            level[i]->right = new Node(int(nodes++));
+            next.push_back(level[i]->left);
+            next.push_back(level[i]->right);
+        }
+        level.swap(next);
+    }
+    return root;
+}
+
+// A single path of n nodes that turns left or right at random.
+static Node* makeSkewed(size_t n, mt19937_64& rng)
+{
+    Node* root = new Node(0);
+    Node* curr = root;
+    for(size_t i = 1; i < n; ++i) {
+        Node* child = new Node(int(i));
+        if(rng() & 1) {
+            curr->left = child;
+        }
+        else {
+            curr->right = child;
+        }
+        curr = child;
+    }
+    return root;
+}
+
+// A tree of n nodes shaped like a BST built from random insertions:
+// the root's rank is uniform and both subtrees are built the same way.
+static Node* makeRandom(size_t n, mt19937_64& rng)
+{
+    Node* root = NULL;
+    vector<pair<Node**, size_t> > pending(1, make_pair(&root, n));
+    int key = 0;
+    while(!pending.empty()) {
+        Node** slot = pending.back().first;
+        size_t count = pending.back().second;
+        pending.pop_back();
+        if(count == 0) {
+            continue;
+        }
+        size_t leftCount = rng() % count;
+        *slot = new Node(key++);
+        pending.push_back(make_pair(&(*slot)->left, leftCount));
+        pending.push_back(make_pair(&(*slot)->right, count - 1 - leftCount));
+    }
+    return root;
+}
+
+static void destroy(Node* root)
+{
+    vector<Node*> pending;
+    if(root != NULL) {
+        pending.push_back(root);
+    }
+    while(!pending.empty()) {
+        Node* n = pending.back();
+        pending.pop_back();
+        if(n->left != NULL) {
+            pending.push_back(n->left);
+        }
+        if(n->right != NULL) {
+            pending.push_back(n->right);
+        }
+        delete n;
+    }
+}
+
+// Best of three runs of check(), which returns the equalPaths answer.
+template<typename Check>
+static double bestSeconds(Check check, bool& result)
+{
+    double best = 0;
+    for(int r = 0; r < 3; ++r) {
+        BenchTimer timer;
+        result = check();
+        double secs = timer.seconds();
+        if(r == 0 || secs < best) {
+            best = secs;
+        }
+    }
+    doNotOptimize(result);
+    return best;
+}
+
+// Times equalPaths on the linked tree, then encodes it in level order and
+// times the bitmap scan. fullWalk marks trees the pointer walk has to
+// follow to the end, where a per-node rate is meaningful.
+static void run(const char* name, Node* root, size_t nodes, bool fullWalk)
+{
+    bool result;
+    double secs = bestSeconds([&]() { return equalPaths(root); }, result);
+    printf("  %-22s %9zu nodes  %-5s  pointers %9.3f ms", name, nodes, result ? "true" : "false", secs * 1e3);
+    if(fullWalk) {
+        printf("  %7.1f Mnodes/s", mops(nodes, secs));
+    }
+    printf("\n");
+
+    BenchTimer timer;
+    LevelOrderTree encoded(root);
+    double encodeSecs = timer.seconds();
+    bool levelResult;
+    double scanSecs = bestSeconds([&]() { return equalPaths(encoded); }, levelResult);
+    printf("  %-22s %9zu levels %-5s  bitmaps  %9.3f ms  (encode %.1f ms, %.1f MB)\n", "", encoded.levels(),
+           levelResult ? "true" : "false", scanSecs * 1e3, encodeSecs * 1e3, encoded.memoryBytes() / 1e6);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t n = argCount(argc, argv, 1, 10000000);
+    mt19937_64 rng(42);
+    size_t nodes;
+
+    Node* root = makePerfect(n, nodes);
+    run("balanced (perfect)", root, nodes, true);
+    // one extra leaf under the rightmost leaf: the mismatch is the very
+    // last leaf the walk reaches
+    Node* last = root;
+    while(last->right != NULL) {
+        last = last->right;
+    }
+    last->right = new Node(-1);
+    run("balanced + 1 deep leaf", root, nodes + 1, true);
+    destroy(root);
+
+    root = makeSkewed(n, rng);
+    run("skewed (path)", root, n, true);
+    destroy(root);
+
+    root = makeRandom(n, rng);
+    run("random (early exit)", root, n, false);
+    destroy(root);
+    return 0;
+}
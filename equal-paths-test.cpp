@@ -1,6 +1,7 @@
 #include <iostream>
 #include <cstdlib>
 #include "equal-paths.h"
+#include "level-order.h"
 using namespace std;
 
 
@@ -18,17 +19,25 @@ void setNode(Node* n, int key, Node* left=NULL, Node* right=NULL)
   n->right = right;
 }
 
+// Prints the answer for the tree under a, both from the linked nodes
+// and from their level-order encoding.
+void report(const char* msg)
+{
+  cout << msg << ": " <<   equalPaths(a) << endl;
+  cout << msg << " (level order): " << equalPaths(LevelOrderTree(a)) << endl;
+}
+
 void test1(const char* msg)
 {
   setNode(a,1,NULL, NULL);
-  cout << msg << ": " <<   equalPaths(a) << endl;
+  report(msg);
 }
 
 void test2(const char* msg)
 {
   setNode(a,1,b,NULL);
   setNode(b,2,NULL,NULL);
-  cout << msg << ": " <<   equalPaths(a) << endl;
+  report(msg);
 }
 
 void test3(const char* msg)
@@ -36,14 +45,14 @@ void test3(const char* msg)
   setNode(a,1,b,c);
   setNode(b,2,NULL,NULL);
   setNode(c,3,NULL,NULL);
-  cout << msg << ": " <<   equalPaths(a) << endl;
+  report(msg);
 }
 
 void test4(const char* msg)
 {
   setNode(a,1,NULL,c);
   setNode(c,3,NULL,NULL);
-  cout << msg << ": " <<   equalPaths(a) << endl;
+  report(msg);
 }
 
 void test5(const char* msg)
@@ -52,7 +61,7 @@ void test5(const char* msg)
   setNode(b,2,NULL,d);
   setNode(c,3,NULL,NULL);
   setNode(d,4,NULL,NULL);
-  cout << msg << ": " <<   equalPaths(a) << endl;
+  report(msg);
 }
 
 int main()
@@ -1,77 +1,55 @@
+#include <vector>
+#include <utility>
+#include <cstdint>
 #include "equal-paths.h"
 using namespace std;
 
 
 // You may add any prototypes of helper functions here
-int pathLengthRight(Node * r, int length);
-int pathLengthLeft(Node * r, int length);
-int pathLength(Node * r, int length);
 
+/**
+ * Walks the tree once, depth first and left to right, with an explicit
+ * stack so that even a degenerate (list-like) tree cannot overflow the
+ * call stack. Only the right child of a node with two children is pushed;
+ * the walk otherwise just moves down, so memory is proportional to the
+ * number of branching nodes on the current path.
+ *
+ * The first leaf found fixes the expected depth. The walk stops as soon
+ * as a leaf at another depth is found, or as soon as it moves below the
+ * expected depth, since any leaf down there would be deeper.
+ */
 bool equalPaths(Node * root)
 {
-   int plr=0;
-   int pll=0;
     if(root == NULL){
         return true;
     }
-    if(root->right == NULL && root->left == NULL){
-        return true;
-    }
-    if(root->right == NULL){
-        return equalPaths(root->left);
-    }
-    if(root->left == NULL){
-        return equalPaths(root->right);
-    }
-    plr = pathLengthRight(root,0);
-    pll = pathLengthLeft(root,0);
-    if(pathLengthRight(root,0) != pathLengthLeft(root,0)){
-        return false;
-    }
-    else {
-        return true;
-    }
-}
-
-
-int pathLength(Node * root, int length){
-     if(root == NULL)
-    {
-        return 0;
-    }
-    if(root->right == NULL && root->left == NULL){
-        return length+1;
-    }
-
-    if(root->right == NULL){
-            return pathLength(root->left, length);
+    vector<pair<Node*, size_t> > pending;
+    size_t leafDepth = SIZE_MAX;
+    Node* curr = root;
+    size_t depth = 0;
+    while(true){
+        if(curr->left != NULL || curr->right != NULL){
+            if(depth >= leafDepth){
+                return false;
+            }
+            if(curr->left != NULL && curr->right != NULL){
+                pending.push_back(make_pair(curr->right, depth + 1));
+            }
+            curr = (curr->left != NULL) ? curr->left : curr->right;
+            ++depth;
+            continue;
         }
-        if(root->left == NULL){
-            return pathLength(root->right, length);
+        if(leafDepth == SIZE_MAX){
+            leafDepth = depth;
         }
-        else{
-
-            if(pathLength(root->left, length) == pathLength(root->right, length)){
-                return length + 1;
-            }
-            else return -1;
-
+        else if(depth != leafDepth){
+            return false;
         }
- }
-int pathLengthRight(Node * root, int length)
-{
-    if(root == NULL)
-    {
-        return 0;
-    }
-    return (length+pathLengthRight(root->right,length+1));
-}
-int pathLengthLeft(Node * root, int length)
-{
-    if(root == NULL)
-    {
-        return 0;
+        if(pending.empty()){
+            return true;
+        }
+        curr = pending.back().first;
+        depth = pending.back().second;
+        pending.pop_back();
     }
-    return (length+pathLengthLeft(root->left,length+1));
 }
-
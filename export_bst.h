@@ -0,0 +1,240 @@
+
+#ifndef EXPORT_BST_H
+#define EXPORT_BST_H
+
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+// Streaming export of a tree to Graphviz DOT or JSON.
+//
+// Both exporters make a single pre-order pass with an explicit stack and
+// write straight to the stream, so they run in O(n) time and O(height)
+// memory whatever the size of the tree. With maxDepth >= 0 only the top
+// maxDepth levels are written node by node; each subtree below that is
+// written as one summary giving its node count, height and key range.
+// Keys and values are written with operator<<.
+
+// Writes value as text, escaped for a DOT label or a JSON string.
+template<typename T>
+void exportText(std::ostream& out, const T& value, bool json)
+{
+    if constexpr (std::is_arithmetic<T>::value && sizeof(T) > 1) {
+        // nothing to escape
+        out << value;
+        return;
+    }
+    std::ostringstream text;
+    text << value;
+    const std::string s = text.str();
+    for(size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        if(c == '"' || c == '\\') {
+            out << '\\' << c;
+        }
+        else if(c == '\n') {
+            out << "\\n";
+        }
+        else if(json && static_cast<unsigned char>(c) < 0x20) {
+            static const char hex[] = "0123456789abcdef";
+            out << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+        }
+        else {
+            out << c;
+        }
+    }
+}
+
+// Writes value as a JSON number if it is arithmetic, otherwise as a string.
+template<typename T>
+void exportJsonValue(std::ostream& out, const T& value)
+{
+    if constexpr (std::is_same<T, bool>::value) {
+        out << (value ? "true" : "false");
+    }
+    else if constexpr (std::is_arithmetic<T>::value && sizeof(T) > 1) {
+        out << value;
+    }
+    else {
+        out << '"';
+        exportText(out, value, true);
+        out << '"';
+    }
+}
+
+/**
+* Counts the nodes and measures the height of the subtree under n, and
+* finds its smallest and largest nodes. scratch is reused between calls
+* so that a whole export allocates only O(height) memory.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::summarizeSubtree(Node<Key, Value>* n, size_t& nodes, int& height,
+    Node<Key, Value>*& minNode, Node<Key, Value>*& maxNode,
+    std::vector<std::pair<Node<Key, Value>*, int> >& scratch) const
+{
+    nodes = 0;
+    height = 0;
+    minNode = n;
+    while(minNode->getLeft() != NULL) {
+        minNode = minNode->getLeft();
+    }
+    maxNode = n;
+    while(maxNode->getRight() != NULL) {
+        maxNode = maxNode->getRight();
+    }
+    scratch.clear();
+    scratch.push_back(std::make_pair(n, 1));
+    while(!scratch.empty()) {
+        Node<Key, Value>* curr = scratch.back().first;
+        int depth = scratch.back().second;
+        scratch.pop_back();
+        ++nodes;
+        height = std::max(height, depth);
+        if(curr->getRight() != NULL) {
+            scratch.push_back(std::make_pair(curr->getRight(), depth + 1));
+        }
+        if(curr->getLeft() != NULL) {
+            scratch.push_back(std::make_pair(curr->getLeft(), depth + 1));
+        }
+    }
+}
+
+/**
+* Writes the tree as a Graphviz digraph. Edges are labelled L and R,
+* lazily removed nodes are dashed, and elided subtrees are boxes.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::exportDot(std::ostream& out, int maxDepth) const
+{
+    struct Frame
+    {
+        Node<Key, Value>* node;
+        int depth;
+        size_t parentId;
+        char side;
+    };
+    std::vector<Frame> stack;
+    std::vector<std::pair<Node<Key, Value>*, int> > scratch;
+    size_t nextId = 0;
+
+    out << "digraph BST {\n";
+    out << "    node [shape=circle];\n";
+    if(root_ != NULL) {
+        Frame first = { root_, 0, 0, 0 };
+        stack.push_back(first);
+    }
+    while(!stack.empty()) {
+        Frame f = stack.back();
+        stack.pop_back();
+        size_t id = nextId++;
+
+        if(maxDepth >= 0 && f.depth >= maxDepth) {
+            size_t nodes;
+            int height;
+            Node<Key, Value>* minNode;
+            Node<Key, Value>* maxNode;
+            summarizeSubtree(f.node, nodes, height, minNode, maxNode, scratch);
+            out << "    n" << id << " [shape=box, label=\"" << nodes << " nodes, height " << height << "\\n[";
+            exportText(out, minNode->getKey(), false);
+            out << " .. ";
+            exportText(out, maxNode->getKey(), false);
+            out << "]\"];\n";
+        }
+        else {
+            out << "    n" << id << " [label=\"";
+            exportText(out, f.node->getKey(), false);
+            out << "\"" << (f.node->isTombstone() ? ", style=dashed" : "") << "];\n";
+            // right first so that the left subtree is written first
+            if(f.node->getRight() != NULL) {
+                Frame child = { f.node->getRight(), f.depth + 1, id, 'R' };
+                stack.push_back(child);
+            }
+            if(f.node->getLeft() != NULL) {
+                Frame child = { f.node->getLeft(), f.depth + 1, id, 'L' };
+                stack.push_back(child);
+            }
+        }
+        if(f.side != 0) {
+            out << "    n" << f.parentId << " -> n" << id << " [label=\"" << f.side << "\"];\n";
+        }
+    }
+    out << "}\n";
+}
+
+/**
+* Writes the tree as nested JSON objects with "key", "value", "left"
+* and "right" members ("removed": true marks a lazily removed node).
+* An elided subtree is written as {"elided": true, "nodes", "height",
+* "min", "max"}; an empty tree or child is null.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::exportJson(std::ostream& out, int maxDepth) const
+{
+    struct Frame
+    {
+        Node<Key, Value>* node;
+        int depth;
+        int state;      // 0 not yet written, 1 left child written, 2 both written
+    };
+    std::vector<Frame> stack;
+    std::vector<std::pair<Node<Key, Value>*, int> > scratch;
+
+    if(root_ == NULL) {
+        out << "null\n";
+        return;
+    }
+    Frame first = { root_, 0, 0 };
+    stack.push_back(first);
+    while(!stack.empty()) {
+        Frame& f = stack.back();
+        Node<Key, Value>* n = f.node;
+        if(f.state == 0 && maxDepth >= 0 && f.depth >= maxDepth) {
+            size_t nodes;
+            int height;
+            Node<Key, Value>* minNode;
+            Node<Key, Value>* maxNode;
+            summarizeSubtree(n, nodes, height, minNode, maxNode, scratch);
+            out << "{\"elided\":true,\"nodes\":" << nodes << ",\"height\":" << height << ",\"min\":";
+            exportJsonValue(out, minNode->getKey());
+            out << ",\"max\":";
+            exportJsonValue(out, maxNode->getKey());
+            out << "}";
+            stack.pop_back();
+            continue;
+        }
+        if(f.state == 0) {
+            out << "{\"key\":";
+            exportJsonValue(out, n->getKey());
+            out << ",\"value\":";
+            exportJsonValue(out, n->getValue());
+            if(n->isTombstone()) {
+                out << ",\"removed\":true";
+            }
+            out << ",\"left\":";
+            f.state = 1;
+            if(n->getLeft() != NULL) {
+                Frame child = { n->getLeft(), f.depth + 1, 0 };
+                stack.push_back(child);
+                continue;
+            }
+            out << "null";
+        }
+        if(f.state == 1) {
+            out << ",\"right\":";
+            f.state = 2;
+            if(n->getRight() != NULL) {
+                Frame child = { n->getRight(), f.depth + 1, 0 };
+                stack.push_back(child);
+                continue;
+            }
+            out << "null";
+        }
+        out << "}";
+        stack.pop_back();
+    }
+    out << "\n";
+}
+
+#endif
@@ -0,0 +1,345 @@
+
+#ifndef INTERVALBST_H
+#define INTERVALBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include "avlbst.h"
+
+/**
+* An AVLNode keyed by a closed interval [start, end] that also holds the
+* largest end point found in its subtree.
+*/
+template <typename Key, typename Value>
+class IntervalNode : public AVLNode<std::pair<Key, Key>, Value>
+{
+public:
+    // Constructor/destructor.
+    IntervalNode(const std::pair<Key, Key>& interval, const Value& value, IntervalNode<Key, Value>* parent);
+    virtual ~IntervalNode();
+
+    // Getter/setter for the subtree's largest end point.
+    const Key& getMaxEnd() const;
+    void setMaxEnd(const Key& maxEnd);
+
+    // Getters for parent, left, and right, redefined to return IntervalNodes.
+    virtual IntervalNode<Key, Value>* getParent() const override;
+    virtual IntervalNode<Key, Value>* getLeft() const override;
+    virtual IntervalNode<Key, Value>* getRight() const override;
+
+protected:
+    Key maxEnd_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the IntervalNode class.
+  -------------------------------------------------
+*/
+
+/**
+* A new node is a leaf, so its largest end point is its own.
+*/
+template<class Key, class Value>
+IntervalNode<Key, Value>::IntervalNode(const std::pair<Key, Key>& interval, const Value& value,
+    IntervalNode<Key, Value> *parent) :
+    AVLNode<std::pair<Key, Key>, Value>(interval, value, parent), maxEnd_(interval.second)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value>
+IntervalNode<Key, Value>::~IntervalNode()
+{
+
+}
+
+template<class Key, class Value>
+const Key& IntervalNode<Key, Value>::getMaxEnd() const
+{
+    return maxEnd_;
+}
+
+template<class Key, class Value>
+void IntervalNode<Key, Value>::setMaxEnd(const Key& maxEnd)
+{
+    maxEnd_ = maxEnd;
+}
+
+template<class Key, class Value>
+IntervalNode<Key, Value> *IntervalNode<Key, Value>::getParent() const
+{
+    return static_cast<IntervalNode<Key, Value>*>(this->parent_);
+}
+
+template<class Key, class Value>
+IntervalNode<Key, Value> *IntervalNode<Key, Value>::getLeft() const
+{
+    return static_cast<IntervalNode<Key, Value>*>(this->left_);
+}
+
+template<class Key, class Value>
+IntervalNode<Key, Value> *IntervalNode<Key, Value>::getRight() const
+{
+    return static_cast<IntervalNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the IntervalNode class.
+  -----------------------------------------------
+*/
+
+
+/**
+* An interval tree: an AVL tree of closed intervals [start, end] ordered
+* by start (ties broken by end, so equal starts can coexist), where every
+* node also records the largest end point in its subtree. The tree keeps
+* that up to date through the same hooks AggregateTree uses, i.e. in
+* rotations, rebuilds and along the path above every insert and remove.
+*
+* Overlap and stabbing queries walk the tree in start order, skipping
+* subtrees whose largest end point lies before the query and stopping at
+* the first start past it. They cost O(log n + k) for k results in the
+* typical case and O(k log n) in the worst case. Lazily removed intervals
+* keep counting toward their subtree's largest end point until compacted,
+* which only makes the pruning more conservative. An interval whose start
+* lies after its end is rejected by insert, since the pruning assumes
+* start <= end.
+*/
+template <class Key, class Value>
+class IntervalTree : public AVLTree<std::pair<Key, Key>, Value>
+{
+public:
+    typedef std::pair<Key, Key> Interval;
+    typedef typename AVLTree<Interval, Value>::iterator iterator;
+    typedef AVLNodeHandle<Interval, Value, IntervalNode<Key, Value> > node_type;
+    typedef typename AVLTree<Interval, Value>::template basic_insert_return_type<node_type> insert_return_type;
+
+    IntervalTree();
+
+    using AVLTree<Interval, Value>::insert;
+    using AVLTree<Interval, Value>::remove;
+    virtual void insert(const std::pair<const Interval, Value>& new_item);
+    void insert(const Key& start, const Key& end, const Value& value);
+    void remove(const Key& start, const Key& end);
+    insert_return_type insert(node_type&& nh);
+    void insert(typename AVLTree<Interval, Value>::node_type&& nh) = delete;
+    node_type extract(const Interval& interval);
+
+    void apply_batch(std::vector<BatchOp<Interval, Value> >&& ops);
+
+    void findOverlapping(const Key& lo, const Key& hi, std::vector<iterator>& out) const;
+    void findStabbing(const Key& point, std::vector<iterator>& out) const;
+    void merge(IntervalTree<Key, Value>& source);
+    void merge(AVLTree<Interval, Value>& source) = delete;
+
+protected:
+    virtual AVLNode<Interval, Value>* createNode(const Interval& key, const Value& value, AVLNode<Interval, Value>* parent);
+    virtual void updateNode(AVLNode<Interval, Value>* n);
+    virtual Node<Interval, Value>* linkLeaf(const std::pair<const Interval, Value>& keyValuePair,
+        Node<Interval, Value>* parent, int cmp);
+    virtual size_t nodeBytes() const;
+    virtual bool checkNode(const Node<Interval, Value>* n, int leftHeight, int rightHeight) const;
+
+    // Helper functions
+    IntervalNode<Key, Value>* getRoot() const;
+    static void checkInterval(const Interval& interval);
+};
+
+template<class Key, class Value>
+IntervalTree<Key, Value>::IntervalTree() :
+    AVLTree<Interval, Value>()
+{
+    this->augmented_ = true;
+}
+
+template<class Key, class Value>
+IntervalNode<Key, Value>* IntervalTree<Key, Value>::getRoot() const
+{
+    return static_cast<IntervalNode<Key, Value>*>(this->root_);
+}
+
+template<class Key, class Value>
+AVLNode<std::pair<Key, Key>, Value>* IntervalTree<Key, Value>::createNode(const Interval& key, const Value& value,
+    AVLNode<Interval, Value>* parent)
+{
+    return new IntervalNode<Key, Value>(key, value, static_cast<IntervalNode<Key, Value>*>(parent));
+}
+
+template<class Key, class Value>
+size_t IntervalTree<Key, Value>::nodeBytes() const
+{
+    return sizeof(IntervalNode<Key, Value>);
+}
+
+template<class Key, class Value>
+void IntervalTree<Key, Value>::updateNode(AVLNode<Interval, Value>* n)
+{
+    IntervalNode<Key, Value>* node = static_cast<IntervalNode<Key, Value>*>(n);
+    Key maxEnd = node->getKey().second;
+    if (node->getLeft() != NULL && maxEnd < node->getLeft()->getMaxEnd()) {
+        maxEnd = node->getLeft()->getMaxEnd();
+    }
+    if (node->getRight() != NULL && maxEnd < node->getRight()->getMaxEnd()) {
+        maxEnd = node->getRight()->getMaxEnd();
+    }
+    node->setMaxEnd(maxEnd);
+}
+
+/**
+* The AVL invariants, plus a largest end point that matches the node's
+* own end and its children's.
+*/
+template<class Key, class Value>
+bool IntervalTree<Key, Value>::checkNode(const Node<Interval, Value>* n, int leftHeight, int rightHeight) const
+{
+    if (!AVLTree<Interval, Value>::checkNode(n, leftHeight, rightHeight)) {
+        return false;
+    }
+    const IntervalNode<Key, Value>* node = static_cast<const IntervalNode<Key, Value>*>(n);
+    Key maxEnd = node->getKey().second;
+    if (node->getLeft() != NULL && maxEnd < node->getLeft()->getMaxEnd()) {
+        maxEnd = node->getLeft()->getMaxEnd();
+    }
+    if (node->getRight() != NULL && maxEnd < node->getRight()->getMaxEnd()) {
+        maxEnd = node->getRight()->getMaxEnd();
+    }
+    return !(maxEnd < node->getMaxEnd()) && !(node->getMaxEnd() < maxEnd);
+}
+
+/**
+* Adds the interval new_item.first, or overwrites its value if that exact
+* interval is already present. Throws std::invalid_argument if the
+* interval starts after it ends.
+*/
+template<class Key, class Value>
+void IntervalTree<Key, Value>::insert(const std::pair<const Interval, Value>& new_item)
+{
+    checkInterval(new_item.first);
+    AVLTree<Interval, Value>::insert(new_item);
+}
+
+/**
+* Adds the interval [start, end], or overwrites its value if that exact
+* interval is already present. Throws std::invalid_argument if start > end.
+*/
+template<class Key, class Value>
+void IntervalTree<Key, Value>::insert(const Key& start, const Key& end, const Value& value)
+{
+    insert(std::make_pair(Interval(start, end), value));
+}
+
+/**
+* The pruning in findOverlapping relies on start <= end, so every path
+* that adds an interval checks it before the tree is touched.
+*/
+template<class Key, class Value>
+void IntervalTree<Key, Value>::checkInterval(const Interval& interval)
+{
+    if (interval.second < interval.first) {
+        throw std::invalid_argument("Interval starts after it ends");
+    }
+}
+
+/**
+* Used by the finger insert.
+*/
+template<class Key, class Value>
+Node<std::pair<Key, Key>, Value>* IntervalTree<Key, Value>::linkLeaf(
+    const std::pair<const Interval, Value>& keyValuePair, Node<Interval, Value>* parent, int cmp)
+{
+    checkInterval(keyValuePair.first);
+    return AVLTree<Interval, Value>::linkLeaf(keyValuePair, parent, cmp);
+}
+
+/**
+* AVLTree::apply_batch, after checking every interval it would add.
+*/
+template<class Key, class Value>
+void IntervalTree<Key, Value>::apply_batch(std::vector<BatchOp<Interval, Value> >&& ops)
+{
+    for (size_t i = 0; i < ops.size(); ++i) {
+        if (!ops[i].remove) {
+            checkInterval(ops[i].key);
+        }
+    }
+    AVLTree<Interval, Value>::apply_batch(std::move(ops));
+}
+
+template<class Key, class Value>
+void IntervalTree<Key, Value>::remove(const Key& start, const Key& end)
+{
+    remove(Interval(start, end));
+}
+
+/**
+* Appends to out, in start order, every interval that shares at least
+* one point with [lo, hi].
+*/
+template<class Key, class Value>
+void IntervalTree<Key, Value>::findOverlapping(const Key& lo, const Key& hi, std::vector<iterator>& out) const
+{
+    std::vector<IntervalNode<Key, Value>*> stack;
+    IntervalNode<Key, Value>* curr = getRoot();
+    while (true) {
+        // nothing in a subtree whose largest end is below lo can overlap
+        while (curr != NULL && !(curr->getMaxEnd() < lo)) {
+            stack.push_back(curr);
+            curr = curr->getLeft();
+        }
+        if (stack.empty()) {
+            break;
+        }
+        curr = stack.back();
+        stack.pop_back();
+        if (hi < curr->getKey().first) {
+            // this and every later interval starts after hi
+            break;
+        }
+        if (!(curr->getKey().second < lo) && !curr->isTombstone()) {
+            out.push_back(this->makeIterator(curr));
+        }
+        curr = curr->getRight();
+    }
+}
+
+/**
+* Appends to out, in start order, every interval containing point.
+*/
+template<class Key, class Value>
+void IntervalTree<Key, Value>::findStabbing(const Key& point, std::vector<iterator>& out) const
+{
+    findOverlapping(point, point, out);
+}
+
+template<class Key, class Value>
+typename IntervalTree<Key, Value>::insert_return_type IntervalTree<Key, Value>::insert(node_type&& nh)
+{
+    return this->insertHandle(std::move(nh));
+}
+
+template<class Key, class Value>
+typename IntervalTree<Key, Value>::node_type IntervalTree<Key, Value>::extract(const Interval& interval)
+{
+    return this->template extractHandle<IntervalNode<Key, Value> >(interval);
+}
+
+/**
+* Only trees with the same node type can be merged.
+*/
+template<class Key, class Value>
+void IntervalTree<Key, Value>::merge(IntervalTree<Key, Value>& source)
+{
+    AVLTree<Interval, Value>::merge(source);
+}
+
+
+#endif
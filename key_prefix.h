@@ -0,0 +1,147 @@
+
+#ifndef KEY_PREFIX_H
+#define KEY_PREFIX_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <type_traits>
+
+// Cached key prefixes for search tree nodes.
+//
+// For key types that own a heap buffer (std::string), every comparison on the
+// way down the tree has to chase that pointer.  A node can instead keep the
+// first few bytes of its key inline, packed big-endian into an integer, so that
+// comparing two prefixes as integers gives the same answer as comparing the
+// bytes lexicographically.  Only when two prefixes are equal does the full key
+// need to be looked at.
+//
+// Define BST_NO_KEY_PREFIX to stop nodes from storing the prefix at all.
+
+/**
+ * Describes the inline prefix a node stores for its key.  The primary
+ * template stores nothing; specialize it to enable prefixes for a key type.
+ */
+template<typename Key>
+struct KeyPrefixTraits
+{
+    static const bool enabled = false;
+    typedef unsigned char type;
+
+    static type make(const Key&)
+    {
+        return 0;
+    }
+};
+
+#ifndef BST_NO_KEY_PREFIX
+/**
+ * std::string keys keep their first 8 bytes, zero padded.
+ */
+template<>
+struct KeyPrefixTraits<std::string>
+{
+    static const bool enabled = true;
+    typedef uint64_t type;
+
+    static type make(std::string_view key)
+    {
+        unsigned char bytes[sizeof(type)] = { 0 };
+        std::memcpy(bytes, key.data(), key.size() < sizeof(type) ? key.size() : sizeof(type));
+        type prefix = 0;
+        for(size_t i = 0; i < sizeof(type); ++i) {
+            prefix = (prefix << 8) | bytes[i];
+        }
+        return prefix;
+    }
+};
+#endif
+
+/**
+ * True when Compare orders keys by their bytes, so that prefixes and
+ * std::string_view::compare agree with it.  std::less<std::string> and
+ * std::less<> qualify; a custom comparator can opt in by declaring an
+ * is_lexicographic member type.
+ */
+template<typename Compare, typename = void>
+struct IsLexicographicCompare : std::false_type { };
+
+template<>
+struct IsLexicographicCompare<std::less<std::string> > : std::true_type { };
+
+template<>
+struct IsLexicographicCompare<std::less<> > : std::true_type { };
+
+template<typename Compare>
+struct IsLexicographicCompare<Compare, std::void_t<typename Compare::is_lexicographic> > : std::true_type { };
+
+/**
+ * True for key types whose Compare order, when lexicographic, is the
+ * order of their bytes.  Other keys that merely convert to
+ * std::string_view, such as const char*, are compared by Compare
+ * itself (which for const char* means by address).
+ */
+template<typename Key>
+struct IsStringKey : std::false_type { };
+
+template<>
+struct IsStringKey<std::string> : std::true_type { };
+
+template<>
+struct IsStringKey<std::string_view> : std::true_type { };
+
+/**
+ * Holds the cached prefix inside a node.  Empty unless the key type
+ * has prefixes enabled.
+ */
+template<typename Key, bool Enabled = KeyPrefixTraits<Key>::enabled>
+class NodeKeyPrefix
+{
+public:
+    explicit NodeKeyPrefix(const Key&) { }
+    typename KeyPrefixTraits<Key>::type getKeyPrefix() const
+    {
+        return 0;
+    }
+};
+
+template<typename Key>
+class NodeKeyPrefix<Key, true>
+{
+public:
+    explicit NodeKeyPrefix(const Key& key) :
+        keyPrefix_(KeyPrefixTraits<Key>::make(key))
+    {
+    }
+    typename KeyPrefixTraits<Key>::type getKeyPrefix() const
+    {
+        return keyPrefix_;
+    }
+
+protected:
+    typename KeyPrefixTraits<Key>::type keyPrefix_;
+};
+
+/**
+ * Three-way key comparison used while descending a tree keyed by Key:
+ * negative if a sorts before b, positive if after and 0 if they are
+ * equivalent.  String keys under a byte-ordered Compare take a single
+ * pass; anything else falls back to at most two calls of Compare.
+ */
+template<typename Key, typename Compare, typename A, typename B>
+int threeWayCompare(const Compare& comp, const A& a, const B& b)
+{
+    if constexpr (IsLexicographicCompare<Compare>::value && IsStringKey<Key>::value &&
+                  std::is_convertible<const A&, std::string_view>::value &&
+                  std::is_convertible<const B&, std::string_view>::value) {
+        return std::string_view(a).compare(std::string_view(b));
+    }
+    else {
+        if(comp(a, b)) return -1;
+        return comp(b, a) ? 1 : 0;
+    }
+}
+
+#endif
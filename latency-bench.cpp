@@ -0,0 +1,108 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include "avlbst.h"
+#include "bench_util.h"
+
+using namespace std;
+
+// Open-loop latency benchmark for AVLTree. Operations are issued on a
+// fixed schedule, one every 1/rate seconds, whether or not the previous
+// one has finished. Each latency is measured from the operation's
+// scheduled start, so a slow operation also charges the ones queued
+// behind it (no coordinated omission). The time from the actual start
+// is reported separately as service time.
+//
+// usage: latency-bench [rate [seconds [read% [insert% [keys]]]]]
+//   rate     operations per second (default 200000)
+//   seconds  length of the run (default 5)
+//   read%    share of find calls (default 80)
+//   insert%  share of inserts (default 10); the rest are removes
+//   keys     keys in the tree at the start (default 1000000); keys are
+//            drawn from twice that range, so about half of the inserts
+//            and removes hit an existing key
+
+enum OpType { READ, INSERT, REMOVE, OP_TYPES };
+
+static void report(const char* name, const LatencyHistogram& h)
+{
+    printf("  %-14s %10llu ops  p50 %9.2f us  p99 %9.2f us  p99.9 %9.2f us  max %10.2f us\n", name,
+           (unsigned long long)h.count(), h.valueAtPercentile(50) / 1e3, h.valueAtPercentile(99) / 1e3,
+           h.valueAtPercentile(99.9) / 1e3, h.max() / 1e3);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t rate = argCount(argc, argv, 1, 200000);
+    size_t seconds = argCount(argc, argv, 2, 5);
+    size_t readPct = argCount(argc, argv, 3, 80);
+    size_t insertPct = argCount(argc, argv, 4, 10);
+    size_t keys = argCount(argc, argv, 5, 1000000);
+    if(rate == 0 || readPct + insertPct > 100 || keys == 0) {
+        cout << "usage: " << argv[0] << " [rate [seconds [read% [insert% [keys]]]]]" << endl;
+        return 1;
+    }
+
+    mt19937_64 rng(48);
+    uniform_int_distribution<uint64_t> keyDist(0, 2 * keys - 1);
+    AVLTree<uint64_t, uint64_t> tree;
+    while(tree.size() < keys) {
+        uint64_t k = keyDist(rng);
+        tree.insert(make_pair(k, k));
+    }
+
+    // the operation sequence is drawn up front so the timed loop only
+    // waits, runs the operation and records
+    size_t ops = rate * seconds;
+    vector<uint8_t> types(ops);
+    vector<uint64_t> opKeys(ops);
+    for(size_t i = 0; i < ops; ++i) {
+        size_t roll = rng() % 100;
+        types[i] = roll < readPct ? READ : roll < readPct + insertPct ? INSERT : REMOVE;
+        opKeys[i] = keyDist(rng);
+    }
+    printf("rate %zu ops/s for %zu s, %zu%% find / %zu%% insert / %zu%% remove, %zu keys\n", rate, seconds,
+           readPct, insertPct, 100 - readPct - insertPct, keys);
+
+    LatencyHistogram latency[OP_TYPES];
+    LatencyHistogram all;
+    LatencyHistogram service;
+    uint64_t found = 0;
+    uint64_t start = nowNanos();
+    for(size_t i = 0; i < ops; ++i) {
+        uint64_t scheduled = start + uint64_t(double(i) * 1e9 / rate);
+        uint64_t now = nowNanos();
+        while(now < scheduled) {
+            now = nowNanos();
+        }
+        switch(types[i]) {
+        case READ:
+            found += tree.find(opKeys[i]) != tree.end();
+            break;
+        case INSERT:
+            tree.insert(make_pair(opKeys[i], uint64_t(i)));
+            break;
+        default:
+            tree.remove(opKeys[i]);
+            break;
+        }
+        uint64_t done = nowNanos();
+        latency[types[i]].record(done - scheduled);
+        all.record(done - scheduled);
+        service.record(done - now);
+    }
+    double elapsed = (nowNanos() - start) / 1e9;
+    doNotOptimize(found);
+
+    printf("achieved %.0f ops/s, %zu keys at the end\n", ops / elapsed, tree.size());
+    printf("latency from scheduled start:\n");
+    report("find", latency[READ]);
+    report("insert", latency[INSERT]);
+    report("remove", latency[REMOVE]);
+    report("all", all);
+    printf("service time (from actual start):\n");
+    report("all", service);
+    return 0;
+}
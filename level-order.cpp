@@ -0,0 +1,137 @@
+#include <vector>
+#include "level-order.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+
+LevelOrderTree::LevelOrderTree(Node* root)
+{
+    levelBegin_.push_back(0);
+    levelWord_.push_back(0);
+    vector<Node*> level;
+    vector<Node*> next;
+    if(root != NULL){
+        level.push_back(root);
+    }
+    while(!level.empty()){
+        size_t base = leftBits_.size();
+        size_t words = (level.size() + 63) / 64;
+        leftBits_.resize(base + words, 0);
+        rightBits_.resize(base + words, 0);
+        next.clear();
+        for(size_t i = 0; i < level.size(); ++i){
+            Node* n = level[i];
+            uint64_t bit = uint64_t(1) << (i % 64);
+            keys_.push_back(n->key);
+            if(n->left != NULL){
+                leftBits_[base + i / 64] |= bit;
+                next.push_back(n->left);
+            }
+            if(n->right != NULL){
+                rightBits_[base + i / 64] |= bit;
+                next.push_back(n->right);
+            }
+        }
+        levelBegin_.push_back(keys_.size());
+        levelWord_.push_back(leftBits_.size());
+        level.swap(next);
+    }
+    // the final sizes are only known at the end; drop the growth slack
+    keys_.shrink_to_fit();
+    leftBits_.shrink_to_fit();
+    rightBits_.shrink_to_fit();
+    levelBegin_.shrink_to_fit();
+    levelWord_.shrink_to_fit();
+}
+
+size_t LevelOrderTree::size() const
+{
+    return keys_.size();
+}
+
+size_t LevelOrderTree::levels() const
+{
+    return levelBegin_.size() - 1;
+}
+
+size_t LevelOrderTree::levelSize(size_t level) const
+{
+    return levelBegin_[level + 1] - levelBegin_[level];
+}
+
+int LevelOrderTree::key(size_t level, size_t i) const
+{
+    return keys_[levelBegin_[level] + i];
+}
+
+bool LevelOrderTree::hasLeft(size_t level, size_t i) const
+{
+    return (leftBits_[levelWord_[level] + i / 64] >> (i % 64)) & 1;
+}
+
+bool LevelOrderTree::hasRight(size_t level, size_t i) const
+{
+    return (rightBits_[levelWord_[level] + i / 64] >> (i % 64)) & 1;
+}
+
+size_t LevelOrderTree::memoryBytes() const
+{
+    return keys_.capacity() * sizeof(int)
+        + (leftBits_.capacity() + rightBits_.capacity()) * sizeof(uint64_t)
+        + (levelBegin_.capacity() + levelWord_.capacity()) * sizeof(size_t);
+}
+
+/**
+ * A node is a leaf when neither of its bits is set, so the level has no
+ * leaves when (left | right) is all ones over its nodes. Full words are
+ * ANDed together two at a time in SSE registers (one at a time without
+ * SSE2), and the level's partial last word is masked.
+ */
+bool LevelOrderTree::levelHasNoLeaves(size_t level) const
+{
+    const uint64_t* left = leftBits_.data() + levelWord_[level];
+    const uint64_t* right = rightBits_.data() + levelWord_[level];
+    size_t count = levelSize(level);
+    size_t full = count / 64;
+    size_t w = 0;
+#if defined(__SSE2__)
+    const __m128i ones = _mm_set1_epi32(-1);
+    __m128i acc = ones;
+    for(; w + 2 <= full; w += 2){
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + w));
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + w));
+        acc = _mm_and_si128(acc, _mm_or_si128(l, r));
+    }
+    if(_mm_movemask_epi8(_mm_cmpeq_epi8(acc, ones)) != 0xffff){
+        return false;
+    }
+#endif
+    uint64_t acc64 = ~uint64_t(0);
+    for(; w < full; ++w){
+        acc64 &= left[w] | right[w];
+    }
+    if(acc64 != ~uint64_t(0)){
+        return false;
+    }
+    size_t rest = count % 64;
+    if(rest != 0){
+        uint64_t mask = (uint64_t(1) << rest) - 1;
+        if(((left[full] | right[full]) & mask) != mask){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool equalPaths(const LevelOrderTree& tree)
+{
+    // the last level is all leaves by construction
+    for(size_t level = 0; level + 1 < tree.levels(); ++level){
+        if(!tree.levelHasNoLeaves(level)){
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef LEVEL_ORDER_H
+#define LEVEL_ORDER_H
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+#include "equal-paths.h"
+
+/**
+ * @brief A read-only copy of a Node tree stored level by level, in
+ *        breadth-first order, instead of as linked nodes.
+ *
+ *        Each level keeps its keys plus two bitmaps saying which of its
+ *        nodes have a left and a right child (bit i is the level's i-th
+ *        node). The children of a level are exactly the next level, in
+ *        order, so the bitmaps alone describe the shape: a tree costs two
+ *        bits per node plus its keys, and questions about the shape become
+ *        sequential scans over a few words per level instead of pointer
+ *        chasing. Every level's bitmaps start on a fresh 64-bit word.
+ */
+class LevelOrderTree
+{
+public:
+    /**
+     * @brief Encodes the tree under root with one breadth-first pass
+     */
+    explicit LevelOrderTree(Node* root);
+
+    size_t size() const;
+    size_t levels() const;
+    size_t levelSize(size_t level) const;
+
+    // i is a node's position within its level
+    int key(size_t level, size_t i) const;
+    bool hasLeft(size_t level, size_t i) const;
+    bool hasRight(size_t level, size_t i) const;
+
+    /**
+     * @brief Heap bytes used by the encoding
+     */
+    size_t memoryBytes() const;
+
+    /**
+     * @brief Returns true if every node of the level has at least one
+     *        child, i.e. the level holds no leaves
+     */
+    bool levelHasNoLeaves(size_t level) const;
+
+private:
+    std::vector<int> keys_;
+    std::vector<uint64_t> leftBits_;
+    std::vector<uint64_t> rightBits_;
+    // first node index and first bitmap word of each level, plus one
+    // entry past the last level
+    std::vector<size_t> levelBegin_;
+    std::vector<size_t> levelWord_;
+};
+
+/**
+ * @brief Same answer as equalPaths(Node*), computed on the level-order
+ *        encoding: all leaves share a depth exactly when no level but the
+ *        last contains a leaf, which is checked a level at a time with
+ *        word-wide (SIMD where available) bit operations, stopping at the
+ *        first level that has one.
+ */
+bool equalPaths(const LevelOrderTree& tree);
+
+#endif
@@ -0,0 +1,398 @@
+
+#ifndef LRUBST_H
+#define LRUBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include "avlbst.h"
+
+/**
+* An AVLNode that is also an entry in its cache's recency list, and
+* remembers how many bytes it was charged against the byte budget.
+*/
+template <typename Key, typename Value>
+class LruNode : public AVLNode<Key, Value>
+{
+public:
+    // Constructor/destructor.
+    LruNode(const Key& key, const Value& value, LruNode<Key, Value>* parent, size_t charge);
+    virtual ~LruNode();
+
+    // Getters/setters for the recency list links.
+    LruNode<Key, Value>* getNewer() const;
+    LruNode<Key, Value>* getOlder() const;
+    void setNewer(LruNode<Key, Value>* newer);
+    void setOlder(LruNode<Key, Value>* older);
+
+    // Getter/setter for the byte charge.
+    size_t getCharge() const;
+    void setCharge(size_t charge);
+
+    // Getters for parent, left, and right, redefined to return LruNodes.
+    virtual LruNode<Key, Value>* getParent() const override;
+    virtual LruNode<Key, Value>* getLeft() const override;
+    virtual LruNode<Key, Value>* getRight() const override;
+
+protected:
+    LruNode<Key, Value>* newer_;
+    LruNode<Key, Value>* older_;
+    size_t charge_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the LruNode class.
+  -------------------------------------------------
+*/
+
+template<class Key, class Value>
+LruNode<Key, Value>::LruNode(const Key& key, const Value& value, LruNode<Key, Value> *parent, size_t charge) :
+    AVLNode<Key, Value>(key, value, parent), newer_(NULL), older_(NULL), charge_(charge)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value>
+LruNode<Key, Value>::~LruNode()
+{
+
+}
+
+template<class Key, class Value>
+LruNode<Key, Value>* LruNode<Key, Value>::getNewer() const
+{
+    return newer_;
+}
+
+template<class Key, class Value>
+LruNode<Key, Value>* LruNode<Key, Value>::getOlder() const
+{
+    return older_;
+}
+
+template<class Key, class Value>
+void LruNode<Key, Value>::setNewer(LruNode<Key, Value>* newer)
+{
+    newer_ = newer;
+}
+
+template<class Key, class Value>
+void LruNode<Key, Value>::setOlder(LruNode<Key, Value>* older)
+{
+    older_ = older;
+}
+
+template<class Key, class Value>
+size_t LruNode<Key, Value>::getCharge() const
+{
+    return charge_;
+}
+
+template<class Key, class Value>
+void LruNode<Key, Value>::setCharge(size_t charge)
+{
+    charge_ = charge;
+}
+
+template<class Key, class Value>
+LruNode<Key, Value> *LruNode<Key, Value>::getParent() const
+{
+    return static_cast<LruNode<Key, Value>*>(this->parent_);
+}
+
+template<class Key, class Value>
+LruNode<Key, Value> *LruNode<Key, Value>::getLeft() const
+{
+    return static_cast<LruNode<Key, Value>*>(this->left_);
+}
+
+template<class Key, class Value>
+LruNode<Key, Value> *LruNode<Key, Value>::getRight() const
+{
+    return static_cast<LruNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the LruNode class.
+  -----------------------------------------------
+*/
+
+
+/**
+* A bounded, ordered cache. Entries live in an AVL tree, so lookups,
+* lower_bound and iteration work in key order, and every node is also
+* linked into a doubly linked recency list. A hit moves the node to the
+* front of that list in O(1) on top of the lookup; once the entry count
+* or the total byte charge goes over budget, the least recently used
+* entries are unlinked from the back of the list and removed from the
+* tree in O(log n) each.
+*
+* Each entry is charged the byte count given to insert, or the size of
+* its node by default. An entry charged more than the whole byte budget
+* is evicted straight away.
+*
+* The tree is a protected base so that nothing can free nodes without
+* also unlinking them from the recency list.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class OrderedLruCache : protected AVLTree<Key, Value, Compare>
+{
+public:
+    typedef typename AVLTree<Key, Value, Compare>::iterator iterator;
+
+    explicit OrderedLruCache(size_t maxEntries, size_t maxBytes = SIZE_MAX);
+    OrderedLruCache(size_t maxEntries, size_t maxBytes, const Compare& comp);
+    virtual ~OrderedLruCache();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void insert(const std::pair<const Key, Value>& keyValuePair, size_t bytes);
+    virtual void remove(const Key& key);
+    virtual void clear();
+
+    iterator find(const Key& key);
+    size_t count(const Key& key) const;
+
+    using AVLTree<Key, Value, Compare>::begin;
+    using AVLTree<Key, Value, Compare>::end;
+    using AVLTree<Key, Value, Compare>::lower_bound;
+    using AVLTree<Key, Value, Compare>::size;
+    using AVLTree<Key, Value, Compare>::empty;
+
+    void setCapacity(size_t maxEntries, size_t maxBytes = SIZE_MAX);
+    size_t getMaxEntries() const;
+    size_t getMaxBytes() const;
+    size_t getByteCount() const;
+    size_t getEvictionCount() const;
+    const Key& leastRecentKey() const;
+
+protected:
+    // Helper functions
+    void unlinkRecency(LruNode<Key, Value>* node);
+    void pushNewest(LruNode<Key, Value>* node);
+    void evict();
+
+    size_t maxEntries_;
+    size_t maxBytes_;
+    size_t bytes_;
+    size_t evictions_;
+    LruNode<Key, Value>* newest_;
+    LruNode<Key, Value>* oldest_;
+};
+
+template<class Key, class Value, class Compare>
+OrderedLruCache<Key, Value, Compare>::OrderedLruCache(size_t maxEntries, size_t maxBytes) :
+    AVLTree<Key, Value, Compare>(),
+    maxEntries_(maxEntries), maxBytes_(maxBytes), bytes_(0), evictions_(0), newest_(NULL), oldest_(NULL)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+OrderedLruCache<Key, Value, Compare>::OrderedLruCache(size_t maxEntries, size_t maxBytes, const Compare& comp) :
+    AVLTree<Key, Value, Compare>(comp),
+    maxEntries_(maxEntries), maxBytes_(maxBytes), bytes_(0), evictions_(0), newest_(NULL), oldest_(NULL)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+OrderedLruCache<Key, Value, Compare>::~OrderedLruCache()
+{
+
+}
+
+/**
+* Takes node out of the recency list.
+*/
+template<class Key, class Value, class Compare>
+void OrderedLruCache<Key, Value, Compare>::unlinkRecency(LruNode<Key, Value>* node)
+{
+    if (node->getNewer() != NULL) {
+        node->getNewer()->setOlder(node->getOlder());
+    }
+    else {
+        newest_ = node->getOlder();
+    }
+    if (node->getOlder() != NULL) {
+        node->getOlder()->setNewer(node->getNewer());
+    }
+    else {
+        oldest_ = node->getNewer();
+    }
+    node->setNewer(NULL);
+    node->setOlder(NULL);
+}
+
+/**
+* Puts an unlinked node at the most recently used end of the list.
+*/
+template<class Key, class Value, class Compare>
+void OrderedLruCache<Key, Value, Compare>::pushNewest(LruNode<Key, Value>* node)
+{
+    node->setOlder(newest_);
+    if (newest_ != NULL) {
+        newest_->setNewer(node);
+    }
+    else {
+        oldest_ = node;
+    }
+    newest_ = node;
+}
+
+/**
+* Removes least recently used entries until both budgets are met.
+*/
+template<class Key, class Value, class Compare>
+void OrderedLruCache<Key, Value, Compare>::evict()
+{
+    while (oldest_ != NULL && (this->size_ > maxEntries_ || bytes_ > maxBytes_)) {
+        LruNode<Key, Value>* victim = oldest_;
+        unlinkRecency(victim);
+        bytes_ -= victim->getCharge();
+        delete this->unlinkNode(victim);
+        ++evictions_;
+    }
+}
+
+/**
+* Inserts or overwrites an entry charged at the size of its node, and
+* makes it the most recently used.
+*/
+template<class Key, class Value, class Compare>
+void OrderedLruCache<Key, Value, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    insert(keyValuePair, sizeof(LruNode<Key, Value>));
+}
+
+/**
+* Inserts or overwrites an entry charged bytes against the byte budget,
+* and makes it the most recently used.
+*/
+template<class Key, class Value, class Compare>
+void OrderedLruCache<Key, Value, Compare>::insert(const std::pair<const Key, Value>& keyValuePair, size_t bytes)
+{
+    AVLNode<Key, Value>* parent;
+    int cmp;
+    LruNode<Key, Value>* node = static_cast<LruNode<Key, Value>*>(
+        this->findInsertPos(keyValuePair.first, parent, cmp));
+    if (node != NULL) {
+        node->setValue(keyValuePair.second);
+        bytes_ -= node->getCharge();
+        node->setCharge(bytes);
+        unlinkRecency(node);
+    }
+    else {
+        node = new LruNode<Key, Value>(keyValuePair.first, keyValuePair.second,
+            static_cast<LruNode<Key, Value>*>(parent), bytes);
+        this->attachNode(node, parent, cmp);
+    }
+    bytes_ += bytes;
+    pushNewest(node);
+    evict();
+}
+
+template<class Key, class Value, class Compare>
+void OrderedLruCache<Key, Value, Compare>::remove(const Key& key)
+{
+    LruNode<Key, Value>* node = static_cast<LruNode<Key, Value>*>(this->internalFind(key));
+    if (node == NULL) {
+        return;
+    }
+    unlinkRecency(node);
+    bytes_ -= node->getCharge();
+    delete this->unlinkNode(node);
+}
+
+template<class Key, class Value, class Compare>
+void OrderedLruCache<Key, Value, Compare>::clear()
+{
+    AVLTree<Key, Value, Compare>::clear();
+    newest_ = NULL;
+    oldest_ = NULL;
+    bytes_ = 0;
+}
+
+/**
+* Looks the key up and, on a hit, makes it the most recently used.
+*/
+template<class Key, class Value, class Compare>
+typename OrderedLruCache<Key, Value, Compare>::iterator
+OrderedLruCache<Key, Value, Compare>::find(const Key& key)
+{
+    LruNode<Key, Value>* node = static_cast<LruNode<Key, Value>*>(this->internalFind(key));
+    if (node != NULL && node != newest_) {
+        unlinkRecency(node);
+        pushNewest(node);
+    }
+    return this->makeIterator(node);
+}
+
+/**
+* Checks for the key without counting it as a use.
+*/
+template<class Key, class Value, class Compare>
+size_t OrderedLruCache<Key, Value, Compare>::count(const Key& key) const
+{
+    return AVLTree<Key, Value, Compare>::count(key);
+}
+
+/**
+* Changes the budgets, evicting right away if they shrank.
+*/
+template<class Key, class Value, class Compare>
+void OrderedLruCache<Key, Value, Compare>::setCapacity(size_t maxEntries, size_t maxBytes)
+{
+    maxEntries_ = maxEntries;
+    maxBytes_ = maxBytes;
+    evict();
+}
+
+template<class Key, class Value, class Compare>
+size_t OrderedLruCache<Key, Value, Compare>::getMaxEntries() const
+{
+    return maxEntries_;
+}
+
+template<class Key, class Value, class Compare>
+size_t OrderedLruCache<Key, Value, Compare>::getMaxBytes() const
+{
+    return maxBytes_;
+}
+
+/**
+* Total charge of the entries currently cached.
+*/
+template<class Key, class Value, class Compare>
+size_t OrderedLruCache<Key, Value, Compare>::getByteCount() const
+{
+    return bytes_;
+}
+
+/**
+* Number of entries evicted to stay within budget since construction.
+*/
+template<class Key, class Value, class Compare>
+size_t OrderedLruCache<Key, Value, Compare>::getEvictionCount() const
+{
+    return evictions_;
+}
+
+/**
+* @precondition The cache is not empty
+* Returns the key that would be evicted next
+*/
+template<class Key, class Value, class Compare>
+const Key& OrderedLruCache<Key, Value, Compare>::leastRecentKey() const
+{
+    return oldest_->getKey();
+}
+
+
+#endif
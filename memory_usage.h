@@ -0,0 +1,102 @@
+
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+// Memory accounting for the trees (see BinarySearchTree::memory_usage).
+//
+// A tree knows how many nodes it has and how big they are, but not how
+// much heap its keys and values own; HeapUsageTraits answers that for a
+// type, and can be specialized for types of your own.
+
+/**
+ * Reports the heap bytes a value owns beyond sizeof(T). The primary
+ * template reports nothing; specializations set enabled, which makes
+ * memory_usage() walk the tree to add them up.
+ */
+template<typename T>
+struct HeapUsageTraits
+{
+    static const bool enabled = false;
+
+    static size_t bytes(const T&)
+    {
+        return 0;
+    }
+};
+
+/**
+ * A std::string owns capacity() + 1 bytes once it outgrows the buffer
+ * inside the string object.
+ */
+template<>
+struct HeapUsageTraits<std::string>
+{
+    static const bool enabled = true;
+
+    static size_t bytes(const std::string& s)
+    {
+        static const size_t inlineCapacity = std::string().capacity();
+        return s.capacity() > inlineCapacity ? s.capacity() + 1 : 0;
+    }
+};
+
+/**
+ * A std::vector owns its capacity, plus whatever its elements own.
+ */
+template<typename T, typename Alloc>
+struct HeapUsageTraits<std::vector<T, Alloc> >
+{
+    static const bool enabled = true;
+
+    static size_t bytes(const std::vector<T, Alloc>& v)
+    {
+        size_t total = v.capacity() * sizeof(T);
+        if(HeapUsageTraits<T>::enabled) {
+            for(size_t i = 0; i < v.size(); ++i) {
+                total += HeapUsageTraits<T>::bytes(v[i]);
+            }
+        }
+        return total;
+    }
+};
+
+/**
+ * Bytes the allocator sets aside for one request of size bytes. glibc
+ * malloc adds an 8-byte header and rounds up to 16 bytes, 32 at least;
+ * elsewhere only the rounding to max_align_t is assumed.
+ */
+inline size_t allocationBytes(size_t size)
+{
+#if defined(__GLIBC__) && defined(__LP64__)
+    size_t chunk = (size + sizeof(size_t) + 15) & ~size_t(15);
+    return chunk < 32 ? 32 : chunk;
+#else
+    const size_t align = alignof(std::max_align_t);
+    return (size + align - 1) / align * align;
+#endif
+}
+
+/**
+ * What memory_usage() returns. All sizes are in bytes.
+ */
+struct MemoryUsage
+{
+    size_t nodes;           // linked nodes, tombstones included
+    size_t nodeBytes;       // nodes * sizeof(node): items, links, vtable pointer, padding
+    size_t itemBytes;       // the part of nodeBytes that holds the key/value pairs
+    size_t heapBytes;       // heap owned by keys and values (HeapUsageTraits)
+    size_t slackBytes;      // allocator headers and rounding of the node allocations
+    size_t otherBytes;      // side tables such as the hot-key cache
+
+    size_t total() const
+    {
+        return nodeBytes + heapBytes + slackBytes + otherBytes;
+    }
+};
+
+#endif
@@ -0,0 +1,584 @@
+
+#ifndef MULTIBST_H
+#define MULTIBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <algorithm>
+#include "avlbst.h"
+
+/**
+* The values stored under one key of an AVLMultiMap. Up to N values
+* live inline in the group itself, and so in the tree node; a larger
+* group moves its values to a heap array that grows geometrically.
+*/
+template <typename Value, unsigned N = 2>
+class DuplicateGroup
+{
+    static_assert(N > 0, "DuplicateGroup needs room for at least one inline value");
+
+public:
+    DuplicateGroup();
+    explicit DuplicateGroup(const Value& value);
+    DuplicateGroup(const DuplicateGroup& other);
+    DuplicateGroup(DuplicateGroup&& other);
+    DuplicateGroup& operator=(const DuplicateGroup& other);
+    DuplicateGroup& operator=(DuplicateGroup&& other);
+    ~DuplicateGroup();
+
+    size_t size() const;
+    bool isInline() const;
+    Value& operator[](size_t i);
+    const Value& operator[](size_t i) const;
+
+    void insert(size_t pos, const Value& value);
+    void erase(size_t pos);
+
+private:
+    Value* data();
+    const Value* data() const;
+    void destroy();
+    void grow();
+
+    size_t size_;
+    size_t capacity_;
+    Value* heap_;   // NULL while the values fit inline
+    alignas(Value) unsigned char inline_[N * sizeof(Value)];
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the DuplicateGroup class.
+  -------------------------------------------------
+*/
+
+template<class Value, unsigned N>
+DuplicateGroup<Value, N>::DuplicateGroup() :
+    size_(0), capacity_(N), heap_(NULL)
+{
+
+}
+
+template<class Value, unsigned N>
+DuplicateGroup<Value, N>::DuplicateGroup(const Value& value) :
+    size_(0), capacity_(N), heap_(NULL)
+{
+    insert(0, value);
+}
+
+template<class Value, unsigned N>
+DuplicateGroup<Value, N>::DuplicateGroup(const DuplicateGroup& other) :
+    size_(0), capacity_(N), heap_(NULL)
+{
+    *this = other;
+}
+
+template<class Value, unsigned N>
+DuplicateGroup<Value, N>::DuplicateGroup(DuplicateGroup&& other) :
+    size_(0), capacity_(N), heap_(NULL)
+{
+    *this = std::move(other);
+}
+
+template<class Value, unsigned N>
+DuplicateGroup<Value, N>& DuplicateGroup<Value, N>::operator=(const DuplicateGroup& other)
+{
+    if (this == &other) {
+        return *this;
+    }
+    destroy();
+    if (other.size_ > N) {
+        heap_ = static_cast<Value*>(::operator new(other.size_ * sizeof(Value)));
+        capacity_ = other.size_;
+    }
+    for (size_t i = 0; i < other.size_; ++i) {
+        new (data() + i) Value(other[i]);
+        ++size_;
+    }
+    return *this;
+}
+
+/**
+* Takes over other's heap array, or moves its inline values one by one.
+* other is left empty.
+*/
+template<class Value, unsigned N>
+DuplicateGroup<Value, N>& DuplicateGroup<Value, N>::operator=(DuplicateGroup&& other)
+{
+    if (this == &other) {
+        return *this;
+    }
+    destroy();
+    if (other.heap_ != NULL) {
+        heap_ = other.heap_;
+        capacity_ = other.capacity_;
+        size_ = other.size_;
+        other.heap_ = NULL;
+        other.capacity_ = N;
+        other.size_ = 0;
+        return *this;
+    }
+    for (size_t i = 0; i < other.size_; ++i) {
+        new (data() + i) Value(std::move(other[i]));
+        ++size_;
+    }
+    other.destroy();
+    return *this;
+}
+
+template<class Value, unsigned N>
+DuplicateGroup<Value, N>::~DuplicateGroup()
+{
+    destroy();
+}
+
+/**
+* Destroys every value and goes back to inline storage.
+*/
+template<class Value, unsigned N>
+void DuplicateGroup<Value, N>::destroy()
+{
+    for (size_t i = 0; i < size_; ++i) {
+        data()[i].~Value();
+    }
+    ::operator delete(heap_);
+    heap_ = NULL;
+    size_ = 0;
+    capacity_ = N;
+}
+
+template<class Value, unsigned N>
+Value* DuplicateGroup<Value, N>::data()
+{
+    return heap_ != NULL ? heap_ : reinterpret_cast<Value*>(inline_);
+}
+
+template<class Value, unsigned N>
+const Value* DuplicateGroup<Value, N>::data() const
+{
+    return heap_ != NULL ? heap_ : reinterpret_cast<const Value*>(inline_);
+}
+
+template<class Value, unsigned N>
+size_t DuplicateGroup<Value, N>::size() const
+{
+    return size_;
+}
+
+/**
+* True while the values are stored in the group itself.
+*/
+template<class Value, unsigned N>
+bool DuplicateGroup<Value, N>::isInline() const
+{
+    return heap_ == NULL;
+}
+
+template<class Value, unsigned N>
+Value& DuplicateGroup<Value, N>::operator[](size_t i)
+{
+    return data()[i];
+}
+
+template<class Value, unsigned N>
+const Value& DuplicateGroup<Value, N>::operator[](size_t i) const
+{
+    return data()[i];
+}
+
+/**
+* Moves the values to a heap array twice the current capacity.
+*/
+template<class Value, unsigned N>
+void DuplicateGroup<Value, N>::grow()
+{
+    size_t capacity = capacity_ < 2 ? 4 : 2 * capacity_;
+    Value* moved = static_cast<Value*>(::operator new(capacity * sizeof(Value)));
+    Value* old = data();
+    for (size_t i = 0; i < size_; ++i) {
+        new (moved + i) Value(std::move(old[i]));
+        old[i].~Value();
+    }
+    ::operator delete(heap_);
+    heap_ = moved;
+    capacity_ = capacity;
+}
+
+/**
+* Inserts value so that it ends up at index pos.
+*/
+template<class Value, unsigned N>
+void DuplicateGroup<Value, N>::insert(size_t pos, const Value& value)
+{
+    if (size_ == capacity_) {
+        grow();
+    }
+    new (data() + size_) Value(value);
+    ++size_;
+    std::rotate(data() + pos, data() + size_ - 1, data() + size_);
+}
+
+template<class Value, unsigned N>
+void DuplicateGroup<Value, N>::erase(size_t pos)
+{
+    std::rotate(data() + pos, data() + pos + 1, data() + size_);
+    --size_;
+    data()[size_].~Value();
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the DuplicateGroup class.
+  -----------------------------------------------
+*/
+
+
+/**
+* Ordering tag for AVLMultiMap: duplicates of a key stay in the order
+* they were inserted.
+*/
+struct InsertionOrder { };
+
+/**
+* An ordered multimap. Each distinct key has one AVL node whose value is
+* a DuplicateGroup, so groups of up to N duplicates cost no allocation
+* beyond the node. Duplicates of a key are kept in insertion order, or
+* sorted by ValueOrder when one is given (ties in insertion order).
+*
+* Iterators visit every (key, value) element, grouped by key; they
+* dereference to a pair of references rather than to a stored pair.
+*/
+template <class Key, class Value, class Compare = std::less<Key>, class ValueOrder = InsertionOrder, unsigned N = 2>
+class AVLMultiMap : protected AVLTree<Key, DuplicateGroup<Value, N>, Compare>
+{
+public:
+    typedef DuplicateGroup<Value, N> Group;
+    typedef AVLTree<Key, Group, Compare> Tree;
+    typedef std::pair<const Key&, Value&> reference;
+
+    /**
+    * Visits the elements in key order, duplicates in group order.
+    */
+    class iterator
+    {
+    public:
+        // Lets it->first and it->second work although no pair is stored.
+        struct pointer
+        {
+            reference ref;
+            reference* operator->() { return &ref; }
+        };
+
+        iterator();
+
+        reference operator*() const;
+        pointer operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class AVLMultiMap<Key, Value, Compare, ValueOrder, N>;
+        iterator(typename Tree::iterator node, size_t index);
+
+        typename Tree::iterator node_;
+        size_t index_;
+    };
+
+    AVLMultiMap();
+    explicit AVLMultiMap(const Compare& comp);
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    virtual void remove(const Key& key);
+    bool removeOne(const Key& key);
+    iterator erase(iterator pos);
+    virtual void clear();
+
+    bool empty() const;
+    size_t size() const;
+    size_t keyCount() const;
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+    std::pair<iterator, iterator> equal_range(const Key& key) const;
+    size_t count(const Key& key) const;
+
+protected:
+    static size_t insertPosition(const Group& group, const Value& value);
+
+    size_t elements_;
+};
+
+/*
+--------------------------------------------------------------
+Begin implementations for the AVLMultiMap::iterator class.
+---------------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator::iterator() :
+    node_(), index_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator::iterator(typename Tree::iterator node, size_t index) :
+    node_(node), index_(index)
+{
+
+}
+
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+typename AVLMultiMap<Key, Value, Compare, ValueOrder, N>::reference
+AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator::operator*() const
+{
+    return reference(node_->first, node_->second[index_]);
+}
+
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+typename AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator::pointer
+AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator::operator->() const
+{
+    pointer p = { **this };
+    return p;
+}
+
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+bool AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator::operator==(const iterator& rhs) const
+{
+    return node_ == rhs.node_ && index_ == rhs.index_;
+}
+
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+bool AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+typename AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator&
+AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator::operator++()
+{
+    if (++index_ == node_->second.size()) {
+        ++node_;
+        index_ = 0;
+    }
+    return *this;
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the AVLMultiMap::iterator class.
+-------------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+AVLMultiMap<Key, Value, Compare, ValueOrder, N>::AVLMultiMap() :
+    Tree(), elements_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+AVLMultiMap<Key, Value, Compare, ValueOrder, N>::AVLMultiMap(const Compare& comp) :
+    Tree(comp), elements_(0)
+{
+
+}
+
+/**
+* Where value goes in a group: at the end in insertion order, otherwise
+* after every value that does not order after it.
+*/
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+size_t AVLMultiMap<Key, Value, Compare, ValueOrder, N>::insertPosition(const Group& group, const Value& value)
+{
+    if constexpr (std::is_same<ValueOrder, InsertionOrder>::value) {
+        return group.size();
+    }
+    else {
+        ValueOrder less;
+        size_t lo = 0;
+        size_t hi = group.size();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (less(value, group[mid])) {
+                hi = mid;
+            }
+            else {
+                lo = mid + 1;
+            }
+        }
+        return lo;
+    }
+}
+
+/**
+* Adds another element; existing elements with the same key are kept.
+* Needs a single descent of the tree either way.
+*/
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+void AVLMultiMap<Key, Value, Compare, ValueOrder, N>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    AVLNode<Key, Group>* parent;
+    int cmp;
+    AVLNode<Key, Group>* existing = this->findInsertPos(keyValuePair.first, parent, cmp);
+    if (existing != NULL) {
+        Group& group = existing->getValue();
+        group.insert(insertPosition(group, keyValuePair.second), keyValuePair.second);
+    }
+    else {
+        this->attachNode(this->createNode(keyValuePair.first, Group(keyValuePair.second), parent), parent, cmp);
+    }
+    ++elements_;
+}
+
+/**
+* Removes every element with the given key.
+*/
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+void AVLMultiMap<Key, Value, Compare, ValueOrder, N>::remove(const Key& key)
+{
+    AVLNode<Key, Group>* node = static_cast<AVLNode<Key, Group>*>(this->internalFind(key));
+    if (node == NULL) {
+        return;
+    }
+    elements_ -= node->getValue().size();
+    delete this->unlinkNode(node);
+}
+
+/**
+* Removes the first element with the given key, if there is one.
+*/
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+bool AVLMultiMap<Key, Value, Compare, ValueOrder, N>::removeOne(const Key& key)
+{
+    iterator it = find(key);
+    if (it == end()) {
+        return false;
+    }
+    erase(it);
+    return true;
+}
+
+/**
+* Removes the single element pos refers to and returns the element
+* after it. Other iterators stay valid unless they refer to the same
+* key, whose later duplicates shift down by one.
+*/
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+typename AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator
+AVLMultiMap<Key, Value, Compare, ValueOrder, N>::erase(iterator pos)
+{
+    Group& group = pos.node_->second;
+    --elements_;
+    if (group.size() > 1) {
+        group.erase(pos.index_);
+        if (pos.index_ == group.size()) {
+            ++pos.node_;
+            pos.index_ = 0;
+        }
+        return pos;
+    }
+    typename Tree::iterator next = pos.node_;
+    ++next;
+    delete this->unlinkNode(static_cast<AVLNode<Key, Group>*>(Tree::iteratorNode(pos.node_)));
+    return iterator(next, 0);
+}
+
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+void AVLMultiMap<Key, Value, Compare, ValueOrder, N>::clear()
+{
+    Tree::clear();
+    elements_ = 0;
+}
+
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+bool AVLMultiMap<Key, Value, Compare, ValueOrder, N>::empty() const
+{
+    return elements_ == 0;
+}
+
+/**
+* Number of elements, counting every duplicate.
+*/
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+size_t AVLMultiMap<Key, Value, Compare, ValueOrder, N>::size() const
+{
+    return elements_;
+}
+
+/**
+* Number of distinct keys.
+*/
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+size_t AVLMultiMap<Key, Value, Compare, ValueOrder, N>::keyCount() const
+{
+    return Tree::size();
+}
+
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+typename AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator
+AVLMultiMap<Key, Value, Compare, ValueOrder, N>::begin() const
+{
+    return iterator(Tree::begin(), 0);
+}
+
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+typename AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator
+AVLMultiMap<Key, Value, Compare, ValueOrder, N>::end() const
+{
+    return iterator(Tree::end(), 0);
+}
+
+/**
+* Returns the first element with the given key, or end().
+*/
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+typename AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator
+AVLMultiMap<Key, Value, Compare, ValueOrder, N>::find(const Key& key) const
+{
+    return iterator(Tree::find(key), 0);
+}
+
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+typename AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator
+AVLMultiMap<Key, Value, Compare, ValueOrder, N>::lower_bound(const Key& key) const
+{
+    return iterator(Tree::lower_bound(key), 0);
+}
+
+/**
+* The elements with the given key, as a [first, second) range.
+*/
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+std::pair<typename AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator,
+          typename AVLMultiMap<Key, Value, Compare, ValueOrder, N>::iterator>
+AVLMultiMap<Key, Value, Compare, ValueOrder, N>::equal_range(const Key& key) const
+{
+    typename Tree::iterator node = Tree::find(key);
+    if (node == Tree::end()) {
+        return std::make_pair(end(), end());
+    }
+    typename Tree::iterator next = node;
+    ++next;
+    return std::make_pair(iterator(node, 0), iterator(next, 0));
+}
+
+template<class Key, class Value, class Compare, class ValueOrder, unsigned N>
+size_t AVLMultiMap<Key, Value, Compare, ValueOrder, N>::count(const Key& key) const
+{
+    typename Tree::iterator node = Tree::find(key);
+    return node == Tree::end() ? 0 : node->second.size();
+}
+
+
+#endif
@@ -0,0 +1,153 @@
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+// Threading helpers shared by the trees' bulk operations.
+
+/**
+ * Number of worker threads to use by default: one per hardware thread,
+ * or 1 if the platform cannot tell.
+ */
+inline unsigned defaultThreadCount()
+{
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+/**
+ * Calls task(i) once for every i in [0, count) on up to `threads`
+ * threads, the calling thread included. Each thread starts on its own
+ * contiguous block of indices and takes them from the front; a thread
+ * whose block runs dry steals the back half of another thread's block,
+ * so tasks of uneven cost still keep every thread busy. Runs inline for
+ * a single thread or task.
+ */
+template<typename Task>
+void parallelForIndex(size_t count, Task task, unsigned threads = defaultThreadCount())
+{
+    size_t workers = std::min<size_t>(threads, count);
+    if (workers < 2) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    struct Block
+    {
+        std::mutex lock;
+        size_t next;
+        size_t end;
+    };
+    std::vector<Block> blocks(workers);
+    for (size_t w = 0; w < workers; ++w) {
+        blocks[w].next = count * w / workers;
+        blocks[w].end = count * (w + 1) / workers;
+    }
+
+    // Gets the next index for thread self, stealing if it has to.
+    // Returns false once no block has any work left.
+    auto take = [&blocks, workers](size_t self, size_t& index) {
+        {
+            std::lock_guard<std::mutex> guard(blocks[self].lock);
+            if (blocks[self].next < blocks[self].end) {
+                index = blocks[self].next++;
+                return true;
+            }
+        }
+        for (size_t k = 1; k < workers; ++k) {
+            Block& victim = blocks[(self + k) % workers];
+            size_t begin;
+            size_t end;
+            {
+                std::lock_guard<std::mutex> guard(victim.lock);
+                size_t left = victim.end - victim.next;
+                if (left == 0) {
+                    continue;
+                }
+                begin = victim.end - (left + 1) / 2;
+                end = victim.end;
+                victim.end = begin;
+            }
+            // only one lock is ever held at a time, so steals cannot deadlock
+            std::lock_guard<std::mutex> guard(blocks[self].lock);
+            blocks[self].next = begin + 1;
+            blocks[self].end = end;
+            index = begin;
+            return true;
+        }
+        return false;
+    };
+    auto run = [&take, &task](size_t self) {
+        size_t index;
+        while (take(self, index)) {
+            task(index);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t w = 1; w < workers; ++w) {
+        pool.push_back(std::thread(run, w));
+    }
+    run(0);
+    for (size_t i = 0; i < pool.size(); ++i) {
+        pool[i].join();
+    }
+}
+
+/**
+ * Stable sort of [first, last) that sorts up to `threads` chunks
+ * concurrently and then merges them pairwise. Falls back to
+ * std::stable_sort for short ranges or a single thread.
+ */
+template<typename Iter, typename Less>
+void parallelStableSort(Iter first, Iter last, Less less, unsigned threads = defaultThreadCount())
+{
+    const size_t minChunk = 1 << 15;
+    size_t n = last - first;
+    size_t chunks = std::min<size_t>(threads, n / minChunk);
+    if (chunks < 2) {
+        std::stable_sort(first, last, less);
+        return;
+    }
+
+    std::vector<Iter> bounds;
+    for (size_t i = 0; i <= chunks; ++i) {
+        bounds.push_back(first + n * i / chunks);
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < chunks; ++i) {
+        workers.push_back(std::thread([&bounds, &less, i]() {
+            std::stable_sort(bounds[i], bounds[i + 1], less);
+        }));
+    }
+    std::stable_sort(bounds[0], bounds[1], less);
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+
+    // merge neighbouring runs until one is left; merging in order keeps it stable
+    for (size_t width = 1; width < chunks; width *= 2) {
+        workers.clear();
+        for (size_t i = 0; i + width < chunks; i += 2 * width) {
+            Iter lo = bounds[i];
+            Iter mid = bounds[i + width];
+            Iter hi = bounds[std::min(i + 2 * width, chunks)];
+            workers.push_back(std::thread([lo, mid, hi, &less]() {
+                std::inplace_merge(lo, mid, hi, less);
+            }));
+        }
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,447 @@
+
+#ifndef RBBST_H
+#define RBBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include "bst.h"
+
+enum RBColor { RB_RED = 0, RB_BLACK = 1 };
+
+/**
+* A special kind of node for a Red-Black tree, which adds the color as a data member.
+*/
+template <typename Key, typename Value>
+class RBNode : public Node<Key, Value>
+{
+public:
+    // Constructor/destructor.
+    RBNode(const Key& key, const Value& value, RBNode<Key, Value>* parent);
+    virtual ~RBNode();
+
+    // Getter/setter for the node's color.
+    RBColor getColor () const;
+    void setColor (RBColor color);
+
+    // Getters for parent, left, and right. These need to be redefined since they
+    // return pointers to RBNodes - not plain Nodes. See the Node class in bst.h
+    // for more information.
+    virtual RBNode<Key, Value>* getParent() const override;
+    virtual RBNode<Key, Value>* getLeft() const override;
+    virtual RBNode<Key, Value>* getRight() const override;
+
+protected:
+    uint8_t color_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the RBNode class.
+  -------------------------------------------------
+*/
+
+/**
+* An explicit constructor to initialize the elements by calling the base class constructor and setting
+* the color to red since every new node will be red when it is first inserted.
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::RBNode(const Key& key, const Value& value, RBNode<Key, Value> *parent) :
+    Node<Key, Value>(key, value, parent), color_(RB_RED)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::~RBNode()
+{
+
+}
+
+/**
+* A getter for the color of a RBNode.
+*/
+template<class Key, class Value>
+RBColor RBNode<Key, Value>::getColor() const
+{
+    return static_cast<RBColor>(color_);
+}
+
+/**
+* A setter for the color of a RBNode.
+*/
+template<class Key, class Value>
+void RBNode<Key, Value>::setColor(RBColor color)
+{
+    color_ = color;
+}
+
+/**
+* An overridden function for getting the parent since a static_cast is necessary to make sure
+* that our node is a RBNode.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getParent() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->parent_);
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getLeft() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->left_);
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getRight() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->right_);
+}
+
+
+/*
+  -----------------------------------------------
+  End implementations for the RBNode class.
+  -----------------------------------------------
+*/
+
+
+/**
+* A Red-Black tree. Compared to AVLTree it keeps a looser balance
+* (height at most 2 log n), which bounds the restructuring work to
+* at most two rotations per insert and three per remove.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class RBTree : public BinarySearchTree<Key, Value, Compare>
+{
+public:
+    RBTree();
+    explicit RBTree(const Compare& comp);
+    using BinarySearchTree<Key, Value, Compare>::insert;
+    virtual void insert (const std::pair<const Key, Value> &new_item);
+protected:
+    virtual void nodeSwap( RBNode<Key,Value>* n1, RBNode<Key,Value>* n2);
+    virtual Node<Key, Value>* linkLeaf(const std::pair<const Key, Value>& keyValuePair, Node<Key, Value>* parent,
+        int cmp);
+    virtual size_t nodeBytes() const;
+    virtual void removeNode(Node<Key, Value>* n);
+    virtual bool checkNode(const Node<Key, Value>* n, int leftHeight, int rightHeight) const;
+
+    // Helper functions
+    static bool isRed(RBNode<Key, Value>* n);
+    static int blackHeight(RBNode<Key, Value>* n);
+    RBNode<Key, Value>* getRoot() const;
+    void insertFix(RBNode<Key, Value>* n);
+    void removeFix(RBNode<Key, Value>* n, RBNode<Key, Value>* parent);
+};
+
+template<class Key, class Value, class Compare>
+RBTree<Key, Value, Compare>::RBTree() :
+    BinarySearchTree<Key, Value, Compare>()
+{
+
+}
+
+template<class Key, class Value, class Compare>
+RBTree<Key, Value, Compare>::RBTree(const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(comp)
+{
+
+}
+
+/**
+* Null children count as black.
+*/
+template<class Key, class Value, class Compare>
+bool RBTree<Key, Value, Compare>::isRed(RBNode<Key, Value>* n)
+{
+    return n != NULL && n->getColor() == RB_RED;
+}
+
+/**
+* Black nodes on the path down the left spine of n, counting the null
+* leaf. In a valid subtree every path has this many.
+*/
+template<class Key, class Value, class Compare>
+int RBTree<Key, Value, Compare>::blackHeight(RBNode<Key, Value>* n)
+{
+    int height = 1;
+    for (; n != NULL; n = n->getLeft()) {
+        if (!isRed(n)) {
+            ++height;
+        }
+    }
+    return height;
+}
+
+template<class Key, class Value, class Compare>
+RBNode<Key, Value>* RBTree<Key, Value, Compare>::getRoot() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->root_);
+}
+
+/*
+ * If key is already in the tree, the current value is
+ * overwritten with the updated value.
+ */
+template<class Key, class Value, class Compare>
+void RBTree<Key, Value, Compare>::insert (const std::pair<const Key, Value> &new_item)
+{
+    RBNode<Key, Value>* parent = NULL;
+    RBNode<Key, Value>* next = getRoot();
+    const typename RBTree<Key, Value, Compare>::KeyPrefix prefix = this->probePrefix(new_item.first);
+    int cmp = 0;
+
+    while (next != NULL) {
+        cmp = this->compareToNode(new_item.first, prefix, next);
+        if (cmp == 0) {
+            next->setValue(new_item.second);
+            return;
+        }
+        parent = next;
+        next = (cmp < 0) ? next->getLeft() : next->getRight();
+    }
+
+    linkLeaf(new_item, parent, cmp);
+}
+
+template<class Key, class Value, class Compare>
+size_t RBTree<Key, Value, Compare>::nodeBytes() const
+{
+    return sizeof(RBNode<Key, Value>);
+}
+
+/**
+* Hangs a new red leaf below parent and restores the red-black
+* properties.
+*/
+template<class Key, class Value, class Compare>
+Node<Key, Value>* RBTree<Key, Value, Compare>::linkLeaf(const std::pair<const Key, Value>& keyValuePair,
+    Node<Key, Value>* parent, int cmp)
+{
+    RBNode<Key, Value>* new_node = new RBNode<Key, Value>(keyValuePair.first, keyValuePair.second,
+        static_cast<RBNode<Key, Value>*>(parent));
+    ++this->size_;
+    if (parent == NULL) {
+        this->root_ = new_node;
+    }
+    else if (cmp < 0) {
+        parent->setLeft(new_node);
+    }
+    else {
+        parent->setRight(new_node);
+    }
+    this->noteLinked(new_node);
+    insertFix(new_node);
+    return new_node;
+}
+
+/**
+* Restores the red-black properties after n was inserted as a red leaf.
+* Recoloring may walk up the tree, but at most two rotations are done.
+*/
+template<class Key, class Value, class Compare>
+void RBTree<Key, Value, Compare>::insertFix(RBNode<Key, Value>* n)
+{
+    RBNode<Key, Value>* parent = n->getParent();
+    while (isRed(parent)) {
+        // a red parent is never the root, so the grandparent exists
+        RBNode<Key, Value>* grandparent = parent->getParent();
+        if (parent == grandparent->getLeft()) {
+            RBNode<Key, Value>* uncle = grandparent->getRight();
+            if (isRed(uncle)) {
+                parent->setColor(RB_BLACK);
+                uncle->setColor(RB_BLACK);
+                grandparent->setColor(RB_RED);
+                n = grandparent;
+                parent = n->getParent();
+                continue;
+            }
+            if (n == parent->getRight()) {
+                this->rotateLeft(parent);
+                n = parent;
+                parent = n->getParent();
+            }
+            parent->setColor(RB_BLACK);
+            grandparent->setColor(RB_RED);
+            this->rotateRight(grandparent);
+        }
+        else {
+            RBNode<Key, Value>* uncle = grandparent->getLeft();
+            if (isRed(uncle)) {
+                parent->setColor(RB_BLACK);
+                uncle->setColor(RB_BLACK);
+                grandparent->setColor(RB_RED);
+                n = grandparent;
+                parent = n->getParent();
+                continue;
+            }
+            if (n == parent->getLeft()) {
+                this->rotateRight(parent);
+                n = parent;
+                parent = n->getParent();
+            }
+            parent->setColor(RB_BLACK);
+            grandparent->setColor(RB_RED);
+            this->rotateLeft(grandparent);
+        }
+        break;
+    }
+    getRoot()->setColor(RB_BLACK);
+}
+
+/*
+ * A node with 2 children is first swapped with its successor,
+ * like AVLTree::removeNode, so that it has at most one child.
+ */
+template<class Key, class Value, class Compare>
+void RBTree<Key, Value, Compare>::removeNode(Node<Key, Value>* n)
+{
+    RBNode<Key, Value>* node = static_cast<RBNode<Key, Value>*>(n);
+
+    if (node->getLeft() != NULL && node->getRight() != NULL) {
+        nodeSwap(node, static_cast<RBNode<Key, Value>*>(this->successor(node)));
+    }
+    this->noteUnlinking(node);
+
+    RBNode<Key, Value>* child = node->getLeft();
+    if (child == NULL) {
+        child = node->getRight();
+    }
+    RBNode<Key, Value>* parent = node->getParent();
+    if (child != NULL) {
+        child->setParent(parent);
+    }
+    if (parent == NULL) {
+        this->root_ = child;
+    }
+    else if (node == parent->getLeft()) {
+        parent->setLeft(child);
+    }
+    else {
+        parent->setRight(child);
+    }
+
+    if (node->getColor() == RB_BLACK) {
+        if (isRed(child)) {
+            child->setColor(RB_BLACK);
+        }
+        else {
+            removeFix(child, parent);
+        }
+    }
+    this->forgetNode(node);
+    delete node;
+    --this->size_;
+}
+
+/**
+* Restores the black height after a black node was removed above n,
+* which may be NULL (hence the separate parent argument).
+*/
+template<class Key, class Value, class Compare>
+void RBTree<Key, Value, Compare>::removeFix(RBNode<Key, Value>* n, RBNode<Key, Value>* parent)
+{
+    while (n != getRoot() && !isRed(n)) {
+        if (n == parent->getLeft()) {
+            RBNode<Key, Value>* sibling = parent->getRight();
+            if (isRed(sibling)) {
+                sibling->setColor(RB_BLACK);
+                parent->setColor(RB_RED);
+                this->rotateLeft(parent);
+                sibling = parent->getRight();
+            }
+            if (!isRed(sibling->getLeft()) && !isRed(sibling->getRight())) {
+                sibling->setColor(RB_RED);
+                n = parent;
+                parent = n->getParent();
+                continue;
+            }
+            if (!isRed(sibling->getRight())) {
+                sibling->getLeft()->setColor(RB_BLACK);
+                sibling->setColor(RB_RED);
+                this->rotateRight(sibling);
+                sibling = parent->getRight();
+            }
+            sibling->setColor(parent->getColor());
+            parent->setColor(RB_BLACK);
+            sibling->getRight()->setColor(RB_BLACK);
+            this->rotateLeft(parent);
+        }
+        else {
+            RBNode<Key, Value>* sibling = parent->getLeft();
+            if (isRed(sibling)) {
+                sibling->setColor(RB_BLACK);
+                parent->setColor(RB_RED);
+                this->rotateRight(parent);
+                sibling = parent->getLeft();
+            }
+            if (!isRed(sibling->getLeft()) && !isRed(sibling->getRight())) {
+                sibling->setColor(RB_RED);
+                n = parent;
+                parent = n->getParent();
+                continue;
+            }
+            if (!isRed(sibling->getLeft())) {
+                sibling->getRight()->setColor(RB_BLACK);
+                sibling->setColor(RB_RED);
+                this->rotateLeft(sibling);
+                sibling = parent->getLeft();
+            }
+            sibling->setColor(parent->getColor());
+            parent->setColor(RB_BLACK);
+            sibling->getLeft()->setColor(RB_BLACK);
+            this->rotateRight(parent);
+        }
+        n = getRoot();
+        break;
+    }
+    if (n != NULL) {
+        n->setColor(RB_BLACK);
+    }
+}
+
+/**
+* Colors belong to positions in the tree, so they move with the swap.
+*/
+template<class Key, class Value, class Compare>
+void RBTree<Key, Value, Compare>::nodeSwap( RBNode<Key,Value>* n1, RBNode<Key,Value>* n2)
+{
+    BinarySearchTree<Key, Value, Compare>::nodeSwap(n1, n2);
+    RBColor tempC = n1->getColor();
+    n1->setColor(n2->getColor());
+    n2->setColor(tempC);
+}
+
+/**
+* The root is black, a red node has no red child, and both subtrees
+* have the same black height. Since every node is checked, comparing
+* the left spines of its subtrees covers every path; this costs
+* O(log n) per node.
+*/
+template<class Key, class Value, class Compare>
+bool RBTree<Key, Value, Compare>::checkNode(const Node<Key, Value>* n, int leftHeight, int rightHeight) const
+{
+    const RBNode<Key, Value>* node = static_cast<const RBNode<Key, Value>*>(n);
+    if (node->getParent() == NULL && node->getColor() == RB_RED) {
+        return false;
+    }
+    if (node->getColor() == RB_RED && (isRed(node->getLeft()) || isRed(node->getRight()))) {
+        return false;
+    }
+    return blackHeight(node->getLeft()) == blackHeight(node->getRight());
+}
+
+
+#endif
@@ -0,0 +1,299 @@
+
+#ifndef SPLAYBST_H
+#define SPLAYBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <algorithm>
+#include "bst.h"
+
+/**
+* How an accessed node is moved toward the root.
+* SPLAY_FULL moves it all the way to the root; SPLAY_SEMI only
+* rotates the parent in the zig-zig case and carries on from the
+* parent, which still roughly halves the depth of the access path
+* but with about half as many rotations.
+*/
+enum SplayMode { SPLAY_FULL, SPLAY_SEMI };
+
+/**
+* A self-adjusting search tree: accessed nodes are rotated toward the
+* root, so frequently used keys stay near the top. Nodes carry no
+* balance information, so the plain Node class is used.
+*
+* Inserts and removes always splay. Lookups through the non-const
+* find and operator[] splay on every k-th access, where k is the
+* splay period (1 by default); lookups through a const tree never
+* restructure it.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class SplayTree : public BinarySearchTree<Key, Value, Compare>
+{
+public:
+    typedef typename BinarySearchTree<Key, Value, Compare>::iterator iterator;
+
+    SplayTree();
+    explicit SplayTree(const Compare& comp);
+    using BinarySearchTree<Key, Value, Compare>::insert;
+    virtual void insert (const std::pair<const Key, Value> &new_item);
+
+    using BinarySearchTree<Key, Value, Compare>::find;
+    using BinarySearchTree<Key, Value, Compare>::operator[];
+    iterator find(const Key& key);
+    Value& operator[](const Key& key);
+
+    void setSplayMode(SplayMode mode);
+    SplayMode getSplayMode() const;
+    void setSplayPeriod(unsigned period);
+    unsigned getSplayPeriod() const;
+
+protected:
+    virtual Node<Key, Value>* linkLeaf(const std::pair<const Key, Value>& keyValuePair, Node<Key, Value>* parent,
+        int cmp);
+    virtual void overwriteNode(Node<Key, Value>* n, const Value& value);
+    virtual void removeNode(Node<Key, Value>* node);
+
+    // Helper functions
+    void rotateUp(Node<Key, Value>* n);
+    void splay(Node<Key, Value>* n, SplayMode mode);
+    Node<Key, Value>* accessNode(const Key& key);
+
+    SplayMode mode_;
+    unsigned period_;
+    unsigned accesses_;
+};
+
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>::SplayTree() :
+    BinarySearchTree<Key, Value, Compare>(),
+    mode_(SPLAY_FULL), period_(1), accesses_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>::SplayTree(const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(comp),
+    mode_(SPLAY_FULL), period_(1), accesses_(0)
+{
+
+}
+
+/**
+* Sets how lookups restructure the tree.
+*/
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::setSplayMode(SplayMode mode)
+{
+    mode_ = mode;
+}
+
+template<class Key, class Value, class Compare>
+SplayMode SplayTree<Key, Value, Compare>::getSplayMode() const
+{
+    return mode_;
+}
+
+/**
+* Lookups splay only every period-th access; 0 is treated as 1.
+*/
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::setSplayPeriod(unsigned period)
+{
+    period_ = period == 0 ? 1 : period;
+    accesses_ = 0;
+}
+
+template<class Key, class Value, class Compare>
+unsigned SplayTree<Key, Value, Compare>::getSplayPeriod() const
+{
+    return period_;
+}
+
+/*
+ * If key is already in the tree, the current value is
+ * overwritten with the updated value. Either way the
+ * node is splayed to the root.
+ */
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::insert (const std::pair<const Key, Value> &new_item)
+{
+    Node<Key, Value>* parent = NULL;
+    Node<Key, Value>* next = this->root_;
+    const typename SplayTree<Key, Value, Compare>::KeyPrefix prefix = this->probePrefix(new_item.first);
+    int cmp = 0;
+
+    while (next != NULL) {
+        cmp = this->compareToNode(new_item.first, prefix, next);
+        if (cmp == 0) {
+            overwriteNode(next, new_item.second);
+            return;
+        }
+        parent = next;
+        next = (cmp < 0) ? next->getLeft() : next->getRight();
+    }
+
+    linkLeaf(new_item, parent, cmp);
+}
+
+/**
+* Hangs a new leaf below parent and splays it to the root.
+*/
+template<class Key, class Value, class Compare>
+Node<Key, Value>* SplayTree<Key, Value, Compare>::linkLeaf(const std::pair<const Key, Value>& keyValuePair,
+    Node<Key, Value>* parent, int cmp)
+{
+    Node<Key, Value>* new_node = BinarySearchTree<Key, Value, Compare>::linkLeaf(keyValuePair, parent, cmp);
+    splay(new_node, SPLAY_FULL);
+    return new_node;
+}
+
+/**
+* Sets the value of an existing key and splays its node to the root, as
+* an insert that finds the key does, whichever insert got here.
+*/
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::overwriteNode(Node<Key, Value>* n, const Value& value)
+{
+    n->setValue(value);
+    splay(n, SPLAY_FULL);
+}
+
+/*
+ * Splays the node to the root and joins its two subtrees by
+ * splaying the largest key of the left one up beside it.
+ */
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::removeNode(Node<Key, Value>* node)
+{
+    this->noteUnlinking(node);
+    splay(node, SPLAY_FULL);
+
+    Node<Key, Value>* left = node->getLeft();
+    Node<Key, Value>* right = node->getRight();
+    if (left == NULL) {
+        this->root_ = right;
+        if (right != NULL) {
+            right->setParent(NULL);
+        }
+    }
+    else {
+        left->setParent(NULL);
+        this->root_ = left;
+        Node<Key, Value>* max = left;
+        while (max->getRight() != NULL) {
+            max = max->getRight();
+        }
+        splay(max, SPLAY_FULL);
+        max->setRight(right);
+        if (right != NULL) {
+            right->setParent(max);
+        }
+    }
+    this->forgetNode(node);
+    delete node;
+    --this->size_;
+}
+
+/**
+* Returns an iterator to the item with the given key, or end(),
+* splaying the node found (or the last node visited) when this
+* access is due for it.
+*/
+template<class Key, class Value, class Compare>
+typename SplayTree<Key, Value, Compare>::iterator
+SplayTree<Key, Value, Compare>::find(const Key& key)
+{
+    return this->makeIterator(accessNode(key));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Compare>
+Value& SplayTree<Key, Value, Compare>::operator[](const Key& key)
+{
+    Node<Key, Value>* node = accessNode(key);
+    if(node == NULL) throw std::out_of_range("Invalid key");
+    return node->getValue();
+}
+
+/**
+* Lookup shared by find and operator[]. A miss splays the last node
+* on the search path so that unsuccessful searches are paid for too.
+*/
+template<class Key, class Value, class Compare>
+Node<Key, Value>* SplayTree<Key, Value, Compare>::accessNode(const Key& key)
+{
+    const typename SplayTree<Key, Value, Compare>::KeyPrefix prefix = this->probePrefix(key);
+    Node<Key, Value>* curr = this->root_;
+    Node<Key, Value>* last = NULL;
+    while (curr != NULL) {
+        int cmp = this->compareToNode(key, prefix, curr);
+        if (cmp == 0) {
+            break;
+        }
+        last = curr;
+        curr = (cmp < 0) ? curr->getLeft() : curr->getRight();
+    }
+
+    if (++accesses_ >= period_) {
+        accesses_ = 0;
+        splay(curr != NULL ? curr : last, mode_);
+    }
+    return curr;
+}
+
+/**
+* Rotates n above its parent.
+*/
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::rotateUp(Node<Key, Value>* n)
+{
+    Node<Key, Value>* parent = n->getParent();
+    if (n == parent->getLeft()) {
+        this->rotateRight(parent);
+    }
+    else {
+        this->rotateLeft(parent);
+    }
+}
+
+/**
+* Moves n toward the root with zig, zig-zig and zig-zag steps.
+*/
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::splay(Node<Key, Value>* n, SplayMode mode)
+{
+    if (n == NULL) {
+        return;
+    }
+    while (n->getParent() != NULL) {
+        Node<Key, Value>* parent = n->getParent();
+        Node<Key, Value>* grandparent = parent->getParent();
+        if (grandparent == NULL) {
+            // zig
+            rotateUp(n);
+        }
+        else if ((n == parent->getLeft()) == (parent == grandparent->getLeft())) {
+            // zig-zig
+            rotateUp(parent);
+            if (mode == SPLAY_SEMI) {
+                // leave n below its parent and carry on from there
+                n = parent;
+                continue;
+            }
+            rotateUp(n);
+        }
+        else {
+            // zig-zag
+            rotateUp(n);
+            rotateUp(n);
+        }
+    }
+}
+
+
+#endif
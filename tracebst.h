@@ -0,0 +1,536 @@
+
+#ifndef TRACEBST_H
+#define TRACEBST_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "avlbst.h"
+
+/**
+* Operations a trace can hold.
+*/
+enum TraceOp
+{
+    TRACE_INSERT = 1,
+    TRACE_REMOVE = 2,
+    TRACE_FIND = 3,         // find, count and operator[]
+    TRACE_LOWER_BOUND = 4,
+    TRACE_CLEAR = 5
+};
+
+/**
+* Describes the key and value types of a trace. Keys and values are
+* stored as their raw bytes, so both must be trivially copyable.
+*/
+struct TraceHeader
+{
+    uint8_t keyBytes;
+    bool keySigned;
+    uint8_t valueBytes;
+};
+
+template <class Key, class Value>
+TraceHeader traceHeaderFor()
+{
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "traced keys and values must be trivially copyable");
+    static_assert(sizeof(Key) <= 255 && sizeof(Value) <= 255, "traced keys and values are at most 255 bytes");
+    TraceHeader header = { uint8_t(sizeof(Key)), std::is_signed<Key>::value, uint8_t(sizeof(Value)) };
+    return header;
+}
+
+/**
+* One decoded trace record. nanos counts from the start of the trace;
+* value is only filled in for inserts.
+*/
+struct TraceRecord
+{
+    TraceOp op;
+    uint64_t nanos;
+    unsigned char key[255];
+    unsigned char value[255];
+};
+
+/**
+* Appends records to a trace file. The file starts with the magic
+* "BSTTRACE", a format version and the TraceHeader; each record is an
+* op byte, the time since the previous record in nanoseconds as a
+* LEB128 varint, the key bytes, and for inserts the value bytes, all in
+* the host's byte order. Records collect in a 64 KB buffer that is
+* written out when full, so recording an operation costs a clock read
+* and a few byte copies.
+*/
+class TraceWriter
+{
+public:
+    TraceWriter(const std::string& path, const TraceHeader& header);
+    ~TraceWriter();
+
+    void record(TraceOp op, const void* key, const void* value);
+    void flush();
+    uint64_t records() const;
+    uint64_t bytes() const;
+
+private:
+    void put(const void* data, size_t length);
+
+    FILE* file_;
+    TraceHeader header_;
+    std::vector<unsigned char> buffer_;
+    size_t used_;
+    uint64_t last_;
+    uint64_t records_;
+    uint64_t bytes_;
+};
+
+/**
+* Reads a trace written by TraceWriter one record at a time.
+*/
+class TraceReader
+{
+public:
+    explicit TraceReader(const std::string& path);
+    ~TraceReader();
+
+    const TraceHeader& header() const;
+    bool next(TraceRecord& record);
+
+private:
+    FILE* file_;
+    TraceHeader header_;
+    uint64_t nanos_;
+};
+
+static const char TRACE_MAGIC[8] = { 'B', 'S', 'T', 'T', 'R', 'A', 'C', 'E' };
+static const uint8_t TRACE_VERSION = 1;
+
+inline uint64_t traceClockNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+  -------------------------------------------------
+  Begin implementations for the TraceWriter class.
+  -------------------------------------------------
+*/
+
+inline TraceWriter::TraceWriter(const std::string& path, const TraceHeader& header) :
+    file_(std::fopen(path.c_str(), "wb")), header_(header), buffer_(1 << 16),
+    used_(0), last_(traceClockNanos()), records_(0), bytes_(0)
+{
+    if (file_ == NULL) {
+        throw std::runtime_error("cannot open trace file " + path);
+    }
+    unsigned char fields[4] = { TRACE_VERSION, header.keyBytes, header.keySigned, header.valueBytes };
+    put(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    put(fields, sizeof(fields));
+}
+
+inline TraceWriter::~TraceWriter()
+{
+    flush();
+    std::fclose(file_);
+}
+
+/**
+* Appends one record; value is ignored unless op is TRACE_INSERT.
+*/
+inline void TraceWriter::record(TraceOp op, const void* key, const void* value)
+{
+    // the largest record is an op byte, a 10-byte varint, a key and a value
+    if (used_ + 11 + 2 * 255 > buffer_.size()) {
+        flush();
+    }
+    uint64_t now = traceClockNanos();
+    uint64_t delta = now - last_;
+    last_ = now;
+    unsigned char* out = &buffer_[used_];
+    *out++ = static_cast<unsigned char>(op);
+    while (delta >= 0x80) {
+        *out++ = static_cast<unsigned char>(delta | 0x80);
+        delta >>= 7;
+    }
+    *out++ = static_cast<unsigned char>(delta);
+    if (op != TRACE_CLEAR) {
+        std::memcpy(out, key, header_.keyBytes);
+        out += header_.keyBytes;
+    }
+    if (op == TRACE_INSERT) {
+        std::memcpy(out, value, header_.valueBytes);
+        out += header_.valueBytes;
+    }
+    size_t length = out - &buffer_[used_];
+    used_ += length;
+    bytes_ += length;
+    ++records_;
+}
+
+inline void TraceWriter::put(const void* data, size_t length)
+{
+    std::memcpy(&buffer_[used_], data, length);
+    used_ += length;
+    bytes_ += length;
+}
+
+inline void TraceWriter::flush()
+{
+    if (used_ > 0) {
+        std::fwrite(buffer_.data(), 1, used_, file_);
+        used_ = 0;
+    }
+    std::fflush(file_);
+}
+
+inline uint64_t TraceWriter::records() const
+{
+    return records_;
+}
+
+/**
+* Bytes written so far, the file header included.
+*/
+inline uint64_t TraceWriter::bytes() const
+{
+    return bytes_;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the TraceWriter class.
+  -----------------------------------------------
+*/
+
+/*
+  -------------------------------------------------
+  Begin implementations for the TraceReader class.
+  -------------------------------------------------
+*/
+
+inline TraceReader::TraceReader(const std::string& path) :
+    file_(std::fopen(path.c_str(), "rb")), nanos_(0)
+{
+    if (file_ == NULL) {
+        throw std::runtime_error("cannot open trace file " + path);
+    }
+    char magic[sizeof(TRACE_MAGIC)];
+    unsigned char fields[4];
+    if (std::fread(magic, 1, sizeof(magic), file_) != sizeof(magic) ||
+        std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 ||
+        std::fread(fields, 1, sizeof(fields), file_) != sizeof(fields) || fields[0] != TRACE_VERSION) {
+        std::fclose(file_);
+        throw std::runtime_error(path + " is not a version 1 tree trace");
+    }
+    header_.keyBytes = fields[1];
+    header_.keySigned = fields[2] != 0;
+    header_.valueBytes = fields[3];
+}
+
+inline TraceReader::~TraceReader()
+{
+    std::fclose(file_);
+}
+
+inline const TraceHeader& TraceReader::header() const
+{
+    return header_;
+}
+
+/**
+* Reads the next record into record. Returns false at the end of the
+* file, and throws if the file ends in the middle of a record.
+*/
+inline bool TraceReader::next(TraceRecord& record)
+{
+    int op = std::fgetc(file_);
+    if (op == EOF) {
+        return false;
+    }
+    if (op < TRACE_INSERT || op > TRACE_CLEAR) {
+        throw std::runtime_error("corrupt trace record");
+    }
+    record.op = static_cast<TraceOp>(op);
+    uint64_t delta = 0;
+    for (unsigned shift = 0; ; shift += 7) {
+        int byte = std::fgetc(file_);
+        if (byte == EOF || shift > 63) {
+            throw std::runtime_error("truncated trace record");
+        }
+        delta |= uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    nanos_ += delta;
+    record.nanos = nanos_;
+    size_t keyBytes = record.op == TRACE_CLEAR ? 0 : header_.keyBytes;
+    size_t valueBytes = record.op == TRACE_INSERT ? header_.valueBytes : 0;
+    if (std::fread(record.key, 1, keyBytes, file_) != keyBytes ||
+        std::fread(record.value, 1, valueBytes, file_) != valueBytes) {
+        throw std::runtime_error("truncated trace record");
+    }
+    return true;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the TraceReader class.
+  -----------------------------------------------
+*/
+
+/**
+* A Tree (AVLTree by default, or any BinarySearchTree) that can log its
+* operations to a trace file for bst-replay. Recording is off until
+* startRecording is called; while it is off every operation costs one
+* extra NULL check. Lookups are only logged when made through the
+* RecordingTree itself, not through a reference to the base tree.
+*
+* apply_batch is logged as its inserts and removes in batch order, which
+* leaves a tree in the same state, and pop_min and pop_max as removes of
+* the keys they popped. extract, merge and inserting node
+* handles move nodes between trees, which a trace cannot describe, so
+* they are hidden.
+*/
+template <class Key, class Value, class Tree = AVLTree<Key, Value> >
+class RecordingTree : public Tree
+{
+public:
+    RecordingTree();
+    virtual ~RecordingTree();
+
+    void startRecording(const std::string& path);
+    void stopRecording();
+    bool isRecording() const;
+    const TraceWriter* getRecorder() const;
+
+    virtual void insert(const std::pair<const Key, Value>& keyValuePair);
+    void insert(typename Tree::finger& f, const std::pair<const Key, Value>& keyValuePair);
+    virtual void remove(const Key& key);
+    virtual void clear();
+    void apply_batch(std::vector<BatchOp<Key, Value> >&& ops);
+    std::pair<Key, Value> pop_min();
+    std::pair<Key, Value> pop_max();
+
+    typename Tree::iterator find(const Key& key) const;
+    typename Tree::iterator find(typename Tree::finger& f, const Key& key) const;
+    size_t count(const Key& key) const;
+    typename Tree::iterator lower_bound(const Key& key) const;
+    typename Tree::iterator lower_bound(typename Tree::finger& f, const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+    template <class... Args> void extract(Args&&...) = delete;
+    template <class... Args> void merge(Args&&...) = delete;
+
+protected:
+    TraceWriter* recorder_;     // NULL while not recording
+};
+
+/*
+  ---------------------------------------------------
+  Begin implementations for the RecordingTree class.
+  ---------------------------------------------------
+*/
+
+template<class Key, class Value, class Tree>
+RecordingTree<Key, Value, Tree>::RecordingTree() :
+    Tree(), recorder_(NULL)
+{
+
+}
+
+template<class Key, class Value, class Tree>
+RecordingTree<Key, Value, Tree>::~RecordingTree()
+{
+    stopRecording();
+}
+
+/**
+* Starts a new trace at path, replacing the file and any trace being
+* recorded. Throws std::runtime_error if the file cannot be created.
+*/
+template<class Key, class Value, class Tree>
+void RecordingTree<Key, Value, Tree>::startRecording(const std::string& path)
+{
+    stopRecording();
+    recorder_ = new TraceWriter(path, traceHeaderFor<Key, Value>());
+}
+
+/**
+* Writes out the rest of the trace and closes it.
+*/
+template<class Key, class Value, class Tree>
+void RecordingTree<Key, Value, Tree>::stopRecording()
+{
+    delete recorder_;
+    recorder_ = NULL;
+}
+
+template<class Key, class Value, class Tree>
+bool RecordingTree<Key, Value, Tree>::isRecording() const
+{
+    return recorder_ != NULL;
+}
+
+template<class Key, class Value, class Tree>
+const TraceWriter* RecordingTree<Key, Value, Tree>::getRecorder() const
+{
+    return recorder_;
+}
+
+template<class Key, class Value, class Tree>
+void RecordingTree<Key, Value, Tree>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    if (recorder_ != NULL) {
+        recorder_->record(TRACE_INSERT, &keyValuePair.first, &keyValuePair.second);
+    }
+    Tree::insert(keyValuePair);
+}
+
+template<class Key, class Value, class Tree>
+void RecordingTree<Key, Value, Tree>::insert(typename Tree::finger& f, const std::pair<const Key, Value>& keyValuePair)
+{
+    if (recorder_ != NULL) {
+        recorder_->record(TRACE_INSERT, &keyValuePair.first, &keyValuePair.second);
+    }
+    Tree::insert(f, keyValuePair);
+}
+
+template<class Key, class Value, class Tree>
+void RecordingTree<Key, Value, Tree>::remove(const Key& key)
+{
+    if (recorder_ != NULL) {
+        recorder_->record(TRACE_REMOVE, &key, NULL);
+    }
+    Tree::remove(key);
+}
+
+template<class Key, class Value, class Tree>
+void RecordingTree<Key, Value, Tree>::clear()
+{
+    if (recorder_ != NULL) {
+        recorder_->record(TRACE_CLEAR, NULL, NULL);
+    }
+    Tree::clear();
+}
+
+/**
+* Only for a Tree with apply_batch (AVLTree and its subclasses).
+*/
+template<class Key, class Value, class Tree>
+void RecordingTree<Key, Value, Tree>::apply_batch(std::vector<BatchOp<Key, Value> >&& ops)
+{
+    if (recorder_ != NULL) {
+        for (size_t i = 0; i < ops.size(); ++i) {
+            if (ops[i].remove) {
+                recorder_->record(TRACE_REMOVE, &ops[i].key, NULL);
+            }
+            else {
+                recorder_->record(TRACE_INSERT, &ops[i].key, &ops[i].value);
+            }
+        }
+    }
+    Tree::apply_batch(std::move(ops));
+}
+
+/**
+* Logged after the pop, once the key is known; popping an empty tree
+* throws and logs nothing.
+*/
+template<class Key, class Value, class Tree>
+std::pair<Key, Value> RecordingTree<Key, Value, Tree>::pop_min()
+{
+    std::pair<Key, Value> item = Tree::pop_min();
+    if (recorder_ != NULL) {
+        recorder_->record(TRACE_REMOVE, &item.first, NULL);
+    }
+    return item;
+}
+
+template<class Key, class Value, class Tree>
+std::pair<Key, Value> RecordingTree<Key, Value, Tree>::pop_max()
+{
+    std::pair<Key, Value> item = Tree::pop_max();
+    if (recorder_ != NULL) {
+        recorder_->record(TRACE_REMOVE, &item.first, NULL);
+    }
+    return item;
+}
+
+template<class Key, class Value, class Tree>
+typename Tree::iterator RecordingTree<Key, Value, Tree>::find(const Key& key) const
+{
+    if (recorder_ != NULL) {
+        recorder_->record(TRACE_FIND, &key, NULL);
+    }
+    return Tree::find(key);
+}
+
+template<class Key, class Value, class Tree>
+typename Tree::iterator RecordingTree<Key, Value, Tree>::find(typename Tree::finger& f, const Key& key) const
+{
+    if (recorder_ != NULL) {
+        recorder_->record(TRACE_FIND, &key, NULL);
+    }
+    return Tree::find(f, key);
+}
+
+template<class Key, class Value, class Tree>
+size_t RecordingTree<Key, Value, Tree>::count(const Key& key) const
+{
+    if (recorder_ != NULL) {
+        recorder_->record(TRACE_FIND, &key, NULL);
+    }
+    return Tree::count(key);
+}
+
+template<class Key, class Value, class Tree>
+typename Tree::iterator RecordingTree<Key, Value, Tree>::lower_bound(const Key& key) const
+{
+    if (recorder_ != NULL) {
+        recorder_->record(TRACE_LOWER_BOUND, &key, NULL);
+    }
+    return Tree::lower_bound(key);
+}
+
+template<class Key, class Value, class Tree>
+typename Tree::iterator RecordingTree<Key, Value, Tree>::lower_bound(typename Tree::finger& f, const Key& key) const
+{
+    if (recorder_ != NULL) {
+        recorder_->record(TRACE_LOWER_BOUND, &key, NULL);
+    }
+    return Tree::lower_bound(f, key);
+}
+
+template<class Key, class Value, class Tree>
+Value& RecordingTree<Key, Value, Tree>::operator[](const Key& key)
+{
+    if (recorder_ != NULL) {
+        recorder_->record(TRACE_FIND, &key, NULL);
+    }
+    return Tree::operator[](key);
+}
+
+template<class Key, class Value, class Tree>
+Value const & RecordingTree<Key, Value, Tree>::operator[](const Key& key) const
+{
+    if (recorder_ != NULL) {
+        recorder_->record(TRACE_FIND, &key, NULL);
+    }
+    return Tree::operator[](key);
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the RecordingTree class.
+  -------------------------------------------------
+*/
+
+#endif